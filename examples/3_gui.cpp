@@ -250,6 +250,34 @@ void Update(float dt)
 
 		gui.EndNode();
 	gui.EndNode();
+
+	gui.Image();
+		gui.pivot(CENTER_RIGHT);
+		gui.anchor(CENTER_RIGHT);
+		gui.posX(-32);
+		gui.size(vec2(300, 600));
+		gui.source(BOX);
+		gui.nineSliceMargin(Edges::All(8.f));
+
+		gui.ListView();
+			gui.margin(Edges::All(16.f));
+			gui.itemCount(100000);
+			gui.rowHeight(30.f);
+
+			u32 firstRow, lastRow;
+			gui.visibleRange(firstRow, lastRow);
+
+			for (u32 row = firstRow; row < lastRow; row++)
+			{
+				gui.LabelKey(std::to_string(row));
+					gui.text("Row " + std::to_string(row));
+					gui.marginLeft(0.f);
+					gui.marginRight(0.f);
+					gui.textAlignment(CENTER_LEFT);
+				gui.EndNode();
+			}
+		gui.EndNode();
+	gui.EndNode();
 }
 
 void Draw()
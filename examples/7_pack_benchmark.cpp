@@ -0,0 +1,42 @@
+#include "bingus.h"
+
+//Times a cold start with and without a resource pack
+//Usage: example_7_pack_benchmark [pack], build the pack with bingus_pack ../res ../res/bingus.pack
+//Run each mode in a fresh process so nothing is cached
+
+int main(int argc, char** argv)
+{
+	SetupWindow(1280, 720, "Pack Benchmark");
+
+	double startTime = glfwGetTime();
+
+	bool usePack = argc > 1;
+	if (usePack && !MountResourcePack(argv[1])) return 1;
+
+	//Engine resources, then everything the examples load on top
+	BingusInit();
+
+	LoadTexture("spritesheet.png");
+	LoadTexture("ui.png");
+	LoadTexture("debug.png");
+	LoadTexture("triangle.png");
+
+	LoadShader("world_vertcolor.vert", "sprite_vertcolor.frag");
+	LoadShader("world_vertcolor.vert", "text_vertcolor.frag");
+	LoadShader("world_vertcolor.vert", "text_sdf.frag");
+	LoadShader("ui_vertcolor.vert", "sprite_vertcolor.frag");
+	LoadShader("ui_vertcolor.vert", "text_vertcolor.frag");
+	LoadShader("ui_vertcolor.vert", "text_sdf.frag");
+
+	LoadFont("arial.ttf", 80);
+	LoadFont("linux_libertine.ttf", 80);
+	LoadFontSDF("inter_semibald.ttf");
+
+	//Make sure the driver has actually finished the uploads
+	glFinish();
+
+	double elapsed = glfwGetTime() - startTime;
+	std::cout << "\nCold start " << (usePack ? "from pack" : "from res folder") << ": " << elapsed * 1000.0 << "ms\n";
+
+	return 0;
+}
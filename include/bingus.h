@@ -1,12 +1,20 @@
 #pragma once
 
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <map>
 #include <unordered_map>
 #include <functional>
+#include <memory>
+#include <tuple>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #include <glad.h>
 #include <glfw/glfw3.h>
@@ -59,6 +67,143 @@ struct Edges
 	static Edges All(float value) { return Edges(value, value, value, value); }
 };
 
+//Callable with inline storage that never allocates, calling one is a single indirect call. Anything that doesn't
+//fit in DELEGATE_STORAGE_SIZE is a compile error rather than a silent heap allocation
+#define DELEGATE_STORAGE_SIZE	(6 * sizeof(void*)) //With the two function pointers a delegate fills one cache line
+
+template<typename Signature>
+class Delegate;
+
+template<typename R, typename... Args>
+class Delegate<R(Args...)>
+{
+public:
+	Delegate() { }
+	Delegate(std::nullptr_t) { }
+
+	//Only callables convert, so overloads taking a delegate or a string don't both match a string literal
+	template<typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Delegate>::value
+		&& std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+	Delegate(F&& function)
+	{
+		Store(std::forward<F>(function));
+	}
+
+	Delegate(const Delegate& other)
+	{
+		CopyFrom(other);
+	}
+
+	Delegate(Delegate&& other) noexcept
+	{
+		MoveFrom(other);
+	}
+
+	~Delegate()
+	{
+		Reset();
+	}
+
+	Delegate& operator=(const Delegate& other)
+	{
+		if (this != &other)
+		{
+			Reset();
+			CopyFrom(other);
+		}
+		return *this;
+	}
+
+	Delegate& operator=(Delegate&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+	Delegate& operator=(std::nullptr_t)
+	{
+		Reset();
+		return *this;
+	}
+
+	R operator()(Args... args) const
+	{
+		return invoke(storage, std::forward<Args>(args)...);
+	}
+
+	explicit operator bool() const { return invoke != nullptr; }
+	bool operator==(std::nullptr_t) const { return invoke == nullptr; }
+	bool operator!=(std::nullptr_t) const { return invoke != nullptr; }
+
+private:
+	enum Operation { COPY, MOVE, DESTROY };
+
+	using InvokeFunction = R(*)(const void*, Args&&...);
+	using ManageFunction = void(*)(Operation, void*, const void*);
+
+	alignas(std::max_align_t) unsigned char storage[DELEGATE_STORAGE_SIZE];
+	InvokeFunction invoke = nullptr;
+	ManageFunction manage = nullptr; //Null for trivially copyable callables, they are just memcpy'd
+
+	template<typename F>
+	void Store(F&& function)
+	{
+		using Callable = std::decay_t<F>;
+		static_assert(sizeof(Callable) <= DELEGATE_STORAGE_SIZE, "Delegate callable too large, capture less or capture by pointer");
+		static_assert(alignof(Callable) <= alignof(std::max_align_t), "Delegate callable is over-aligned");
+
+		if constexpr (std::is_pointer<Callable>::value)
+		{
+			if (function == nullptr) return;
+		}
+
+		new (storage) Callable(std::forward<F>(function));
+		invoke = [](const void* callable, Args&&... args) -> R {
+			return (*const_cast<Callable*>(static_cast<const Callable*>(callable)))(std::forward<Args>(args)...);
+		};
+
+		if constexpr (!std::is_trivially_copyable<Callable>::value)
+		{
+			manage = [](Operation operation, void* destination, const void* source) {
+				switch (operation)
+				{
+				case COPY: new (destination) Callable(*static_cast<const Callable*>(source)); break;
+				case MOVE: new (destination) Callable(std::move(*const_cast<Callable*>(static_cast<const Callable*>(source)))); break;
+				case DESTROY: static_cast<Callable*>(destination)->~Callable(); break;
+				}
+			};
+		}
+	}
+
+	void CopyFrom(const Delegate& other)
+	{
+		if (other.manage != nullptr) other.manage(COPY, storage, other.storage);
+		else memcpy(storage, other.storage, sizeof(storage));
+		invoke = other.invoke;
+		manage = other.manage;
+	}
+
+	void MoveFrom(Delegate& other)
+	{
+		if (other.manage != nullptr) other.manage(MOVE, storage, other.storage);
+		else memcpy(storage, other.storage, sizeof(storage));
+		invoke = other.invoke;
+		manage = other.manage;
+		other.Reset();
+	}
+
+	void Reset()
+	{
+		if (manage != nullptr) manage(DESTROY, storage, nullptr);
+		invoke = nullptr;
+		manage = nullptr;
+	}
+};
+
 //Time tracking
 extern float avgFrameTime;
 extern i32 framesPerSecond;
@@ -72,15 +217,53 @@ float GetTime();
 void SetFixedTimestep(float dt);
 float GetFixedTimestep();
 float GetTimestepAlpha();
+//Each fixed update step dispatches the input that came in during the slice of time it simulates, by event timestamp,
+//and what is left is dispatched once the steps are done. HOLD bindings then fire once per step too
+void SetSubframeInput(bool enabled);
+
+//Adaptive timestep lowers the fixed rate, down to maxTimestep, while fixed updates take more than half the real time
+//they simulate, and raises it back to the SetFixedTimestep rate once they are cheap again. Steps per frame are capped
+//and any backlog past the cap is dropped, so a slow frame slows the game down instead of spiralling. It is held off
+//while input is recorded or replayed, so a replay takes the same steps as the recording
+#define ADAPTIVE_TIMESTEP_HIGH_LOAD		0.5f
+#define ADAPTIVE_TIMESTEP_LOW_LOAD		0.25f
+#define ADAPTIVE_TIMESTEP_MAX_STEPS		4
+
+void SetAdaptiveTimestep(bool enabled, float maxTimestep = 1.f / 20.f);
 
+//Interpolated transforms, kept as current and previous fixed step state. Write them from fixed update and anything
+//drawn through them is blended between the last two steps by the timestep alpha
+#define TRANSFORM_NONE	UINT32_MAX
+
+struct Transform2D
+{
+	vec3 position = vec3(0);
+	float rotation = 0.f; //Degrees, like Sprite
+	vec2 scale = vec2(1);
+};
+
+u32 CreateTransform(const Transform2D& transform = Transform2D());
+void DestroyTransform(u32 transform);
+//Current state, the reference is invalidated by CreateTransform
+Transform2D& GetTransform(u32 transform);
+//Sets both states so the move isn't blended
+void TeleportTransform(u32 transform, const Transform2D& value);
+Transform2D GetInterpolatedTransform(u32 transform);
+//Blends two fixed step states by alpha, rotation takes the short way round
+Transform2D InterpolateTransform(const Transform2D& previous, const Transform2D& current, float alpha);
+
+//Timers are stopwatches read off a shared clock when asked, so they cost nothing per frame. They come from a pool,
+//hand them back with DestroyTimer
 struct Timer
 {
-	float timeElapsed;
+	float elapsedAtStart; //Elapsed time when last played, reset or changed speed
+	double startTime; //Timer clock at that point
 	float speed;
 	bool paused;
 
-	~Timer();
-
+	float GetTimeElapsed() const;
+	void SetTimeElapsed(float time);
+	void SetSpeed(float speed);
 	void Reset();
 	void Stop();
 	void Pause();
@@ -88,10 +271,58 @@ struct Timer
 };
 
 Timer* CreateTimer();
+void DestroyTimer(Timer* timer);
+
+//Scheduled callbacks sit in a hierarchical timer wheel, TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots with
+//the bottom level TIMER_WHEEL_TICK seconds per slot. Scheduling and cancelling are constant time, and advancing only
+//visits the slots the clock passes over
+#define TIMER_WHEEL_TICK		(1.0 / 1000.0)
+#define TIMER_WHEEL_SLOT_BITS	6
+#define TIMER_WHEEL_SLOTS		(1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_LEVELS		4
+
+typedef Delegate<void(void)> TimerCallback;
+
+struct TimerHandle
+{
+	u32 index = 0;
+	u32 generation = 0;
+};
+
+TimerHandle ScheduleTimer(float delay, TimerCallback callback);
+TimerHandle ScheduleRepeatingTimer(float interval, TimerCallback callback);
+void CancelTimer(TimerHandle handle);
+bool IsTimerScheduled(TimerHandle handle);
+//Called once per frame by RunGame, moves timers and fires any callbacks that come due
+void AdvanceTimers(float dt);
 
 //Colors
 void SetClearColor(vec4 color);
 
+//Frame pacing. CAP sleeps most of the way to the next present and spins the rest, ADAPTIVE_VSYNC waits for vsync but
+//presents late frames straight away and lets them tear, falling back to VSYNC if the driver can't
+enum FramePacing
+{
+	FRAME_PACING_UNCAPPED, FRAME_PACING_VSYNC, FRAME_PACING_ADAPTIVE_VSYNC, FRAME_PACING_CAP
+};
+
+#define FRAME_PACING_SAMPLES		120
+#define FRAME_PACING_MIN_SPIN		0.0005
+#define FRAME_PACING_MAX_SPIN		0.004
+
+struct FramePacingStats
+{
+	float presentInterval; //Average seconds between presents over the last FRAME_PACING_SAMPLES frames
+	float jitter; //Standard deviation of the present interval
+	float worstInterval;
+	float waitTime; //Time the last frame spent sleeping and spinning for the cap
+};
+
+//targetFPS is only used by FRAME_PACING_CAP. Needs a window, BingusInit starts out on VSYNC
+void SetFramePacing(FramePacing mode, float targetFPS = 60.f);
+FramePacing GetFramePacing();
+FramePacingStats GetFramePacingStats();
+
 //Game Events
 void BingusInit();
 void RunGame();
@@ -154,16 +385,28 @@ bool PointIntersectsCamera(vec2 position, float buffer = 0.f);
 struct Texture
 {
 	vec2 size;
-	u32 id;
+	u32 id = 0;
 	i32 cachedWrapMode;
 	i32 cachedFilterMode;
+	bool loading = false; //Still showing the placeholder, see LoadTextureAsync
+	u64 memorySize = 0; //Estimated GPU memory, including mips
 
 	void SetWrapMode(i32 wrapMode);
 	void SetFilterMode(i32 filterMode);
 };
 
+//Maps a pack built by the bingus_pack tool. While mounted, LoadTexture, LoadShader and LoadFont read anything the pack
+//contains from it instead of the res folder. Textures and shaders are copied into GL and fonts copy their data out, so
+//the pack can be unmounted while resources loaded from it are still in use
+bool MountResourcePack(std::string filePath);
+void UnmountResourcePack();
+
 //Returns a pointer to a managed texture resource. Will load from disk upon first call.
+//.dds files holding BC1, BC3 or BC7 blocks are uploaded compressed with their own mips, make them with bingus_pack --dds
 Texture* LoadTexture(std::string filenameAndPath);
+//Returns a pointer to a managed texture resource straight away. It shows a placeholder until the file has been
+//decoded on a worker thread and uploaded by UpdateResourceLoading, the pointer stays valid throughout
+Texture* LoadTextureAsync(std::string filenameAndPath);
 
 //Shader
 enum ShaderType { VERTEX, FRAGMENT };
@@ -171,12 +414,29 @@ enum ShaderType { VERTEX, FRAGMENT };
 #define SHADER_COLOR		0x01
 #define SHADER_MAIN_TEX		0x02
 #define SHADER_SPEC_POW		0x04 
+#define SHADER_UNIFORM_COUNT	3
+
+//Uniform ids are single bits, this is the index of one in a shader's uniform arrays
+constexpr u32 ShaderUniformSlot(u32 uniform)
+{
+	u32 slot = 0;
+	while (uniform > 1)
+	{
+		uniform >>= 1;
+		slot++;
+	}
+
+	return slot;
+}
 
 struct Shader
 {
 	u32 id;
 	u32 uniforms;
-	std::unordered_map<u32, u32> uniformLocations;
+	i32 uniformLocations[SHADER_UNIFORM_COUNT] = {};
+	//Last value sent for each uniform, so setting the value it already has doesn't reach GL
+	u32 uniformValues[SHADER_UNIFORM_COUNT][4] = {};
+	u32 uniformValuesSet = 0;
 
 	void EnableUniform(u32 uniformID, const char* uniformName);
 	void EnableUniforms(u32 uniformMask);
@@ -190,7 +450,6 @@ struct Shader
 };
 
 Shader* LoadShader(std::string vertexFilenameAndPath, std::string fragFilenameAndPath);
-extern u32 activeShaderID;
 
 //Vertex
 enum VertexType { POS_COLOR, POS_UV, POS_UV_COLOR };
@@ -256,6 +515,52 @@ struct VertBuffer
 void SetActiveShader(Shader* shader);
 extern Shader* activeShader;
 
+//GL state cache. Everything the engine binds or toggles goes through these so calls that wouldn't change anything
+//are skipped. Code that calls GL directly should call ResetGLStateCache afterwards
+#define GL_STATE_TEXTURE_UNITS 8
+
+void UseProgram(u32 id);
+void BindVertexArray(u32 vao);
+//GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER or GL_UNIFORM_BUFFER
+void BindBuffer(u32 target, u32 buffer);
+//Binds to GL_TEXTURE_2D on the given unit and leaves that unit active
+void BindTexture(u32 id, u32 unit = 0);
+//GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST or GL_LINE_SMOOTH
+void SetCapability(u32 capability, bool enabled);
+void SetBlendFunc(u32 source, u32 destination);
+void SetDepthFunc(u32 func);
+//Deleting through these keeps the cache from thinking a reused name is still bound
+void DeleteTexture(u32 id);
+void DeleteBuffer(u32 buffer);
+void DeleteVertexArray(u32 vao);
+void DeleteProgram(u32 id);
+//Forgets everything the cache knows without touching GL, so whatever direct calls left set stays set
+void ResetGLStateCache();
+
+//GL calls made, and skipped because they wouldn't have changed anything
+struct GLCallStats
+{
+	u32 programBinds = 0;
+	u32 programBindsSkipped = 0;
+	u32 vertexArrayBinds = 0;
+	u32 vertexArrayBindsSkipped = 0;
+	u32 bufferBinds = 0;
+	u32 bufferBindsSkipped = 0;
+	u32 textureBinds = 0;
+	u32 textureBindsSkipped = 0;
+	u32 stateChanges = 0; //Capabilities, blend and depth functions, texture parameters
+	u32 stateChangesSkipped = 0;
+	u32 uniformSets = 0;
+	u32 uniformSetsSkipped = 0;
+	u32 drawCalls = 0;
+
+	u32 Issued() const;
+	u32 Skipped() const;
+	GLCallStats operator-(const GLCallStats& other) const;
+};
+
+extern GLCallStats glCallStats;
+
 //Rectangle anchors
 #define TOP_LEFT		vec2(0.0, 1.0)
 #define TOP_CENTER		vec2(0.5, 1.0)
@@ -289,24 +594,56 @@ struct SpriteSheet
 {
 	Texture* texture;
 	std::map<std::string, SpriteSequence> sequences;
+	std::vector<SpriteSequence*> sequenceTable; //Indexed by the ids GetSequenceID hands out
 
 	SpriteSheet() { }
 	SpriteSheet(Texture* texture);
 	SpriteSheet(Texture* texture, std::map<std::string, SpriteSequence> sequences);
+	//Copies point their table at their own sequences, moving keeps the map's nodes so the table stays valid
+	SpriteSheet(const SpriteSheet& other);
+	SpriteSheet(SpriteSheet&& other) = default;
+	SpriteSheet& operator=(const SpriteSheet& other);
+	SpriteSheet& operator=(SpriteSheet&& other) = default;
+
+	//Interns the name, creating the sequence if it doesn't exist like sequences[name] would. Look ids up once and keep them
+	u32 GetSequenceID(const std::string& name);
 };
 
+#define SPRITE_ATLAS_PADDING	2
+#define SPRITE_ATLAS_MIN_SIZE	256
+#define SPRITE_ATLAS_MAX_SIZE	8192
+#define SPRITE_ATLAS_MAX_FRAME_DIGITS	6
+
+//Packs loose images into one shared texture so a single SpriteBatch can draw all of them. Each image becomes a sequence
+//named after its path without the extension, numbered runs of two or more like "walk_1.png", "walk_2.png" become frames
+//of one "walk" sequence, counted from the lowest number. The result is cached by atlasName
+SpriteSheet* LoadSpriteAtlas(std::string atlasName, const std::vector<std::string>& filenamesAndPaths, u32 padding = SPRITE_ATLAS_PADDING);
+
+//Animator state lives in contiguous arrays that UpdateSpriteAnimations advances together once a frame, which also
+//works out the UV rect of each animator's current frame ready for the sprite batch. SpriteAnimator is a handle to it,
+//copies share the same animation and Destroy frees it
+#define SPRITE_ANIMATION_NONE	UINT32_MAX
+
 struct SpriteAnimator
 {
-	SpriteSequence* sequence;
-	SpriteSheet* sheet;
-	Timer* timer;
+	u32 animation = SPRITE_ANIMATION_NONE;
 
 	SpriteAnimator() { }
+	SpriteAnimator(SpriteSheet* sheet, u32 sequenceID, float speed);
 	SpriteAnimator(SpriteSheet* sheet, std::string sequenceName, float speed);
+	void Destroy();
 	u32 GetFrame();
+	SpriteSequence* GetSequence();
+	vec4 GetUVRect(); //uvMin in xy, uvMax in zw
+	//Restarts the animation, the sequence's frame count is read here so add frames before setting it
+	void SetSequence(u32 sequenceID);
 	void SetSequence(std::string name);
+	void SetSpeed(float speed); //Frames per second
 };
 
+//Called once per frame by RunGame
+void UpdateSpriteAnimations(float dt);
+
 struct Sprite
 {
 	vec4 color = vec4(1);
@@ -318,6 +655,7 @@ struct Sprite
 	SpriteAnimator* animator = nullptr;
 	u32 sequenceFrame = 0;
 	float rotation = 0.f;
+	u32 transform = TRANSFORM_NONE; //When set, the interpolated transform replaces position and rotation and scales size
 };
 
 struct RenderBatch
@@ -346,22 +684,162 @@ struct FontCharacter
 	vec2 uvMin, uvMax;
 	vec2 size, bearing;
 	float advance;
+	i32 codepoint;
+	u32 lastUsedFrame;
+	bool resident; //False until the glyph has been rasterised into the glyph atlas
 };
 
 struct FontCharacterRect
 {
 	vec2 position, size;
-	FontCharacter* character;
+	vec2 uvMin, uvMax;
 };
 
+#define FONT_DIRECT_GLYPH_COUNT	256
+#define FONT_GLYPH_EMPTY		0
+#define FONT_GLYPH_REPLACEMENT	1
+#define FONT_GLYPH_NONE			0xFFFFFFFF
+
+//Every font rasterises into one shared GL_RED atlas. Glyphs are rasterised the first time they are looked up,
+//when the atlas fills up the least recently used glyphs are evicted at the start of the next frame and the
+//atlas generation changes. Anything that keeps glyph UVs across frames should rebuild when it does
+#define GLYPH_ATLAS_SIZE 2048
+
+struct FontSource;
+
+extern u32 glyphAtlasFrame;
+
 struct Font
 {
 	Texture texture;
 	u32 lineHeight;
-	std::map<i32, FontCharacter> characters;
+	FontSource* source;
+	bool loading; //Still a copy of the placeholder font, see LoadFontAsync
+	bool sdf; //Glyphs are stored as distance fields and need an SDF text shader
+
+	//Codepoints below FONT_DIRECT_GLYPH_COUNT index straight into directGlyphs, the rest go through a linear
+	//probing table. Both hold indices into glyphs. Codepoints the font doesn't have resolve to the replacement
+	//glyph, control codes resolve to an empty glyph and codepoints that haven't been looked up yet to FONT_GLYPH_NONE
+	std::vector<FontCharacter> glyphs;
+	u32 directGlyphs[FONT_DIRECT_GLYPH_COUNT];
+	std::vector<i32> extendedCodepoints;
+	std::vector<u32> extendedGlyphs;
+	u32 extendedCount;
+
+	Font();
+	void SetGlyphIndex(i32 codepoint, u32 index);
+	void SetReplacementGlyph(i32 codepoint);
+	bool HasGlyph(i32 codepoint) const;
+	u32 LoadGlyph(i32 codepoint);
+	bool RasterizeGlyph(u32 index);
+	bool RasterizeGlyphSDF(u32 index);
+
+	static u32 HashCodepoint(i32 codepoint)
+	{
+		u32 hash = (u32)codepoint * 0x9E3779B1u;
+		return hash ^ (hash >> 15);
+	}
+
+	u32 FindGlyphIndex(i32 codepoint) const
+	{
+		if ((u32)codepoint < FONT_DIRECT_GLYPH_COUNT) return directGlyphs[codepoint];
+		if (extendedCount == 0) return FONT_GLYPH_NONE;
+
+		u32 mask = (u32)extendedCodepoints.size() - 1;
+		for (u32 slot = HashCodepoint(codepoint) & mask;; slot = (slot + 1) & mask)
+		{
+			if (extendedCodepoints[slot] == codepoint) return extendedGlyphs[slot];
+			if (extendedCodepoints[slot] == -1) return FONT_GLYPH_NONE;
+		}
+	}
+
+	const FontCharacter& GetGlyph(i32 codepoint)
+	{
+		u32 index = FindGlyphIndex(codepoint);
+		if (index == FONT_GLYPH_NONE) index = LoadGlyph(codepoint);
+
+		//Glyphs that don't fit in the atlas this frame draw as empty until it is compacted
+		if (!glyphs[index].resident && !RasterizeGlyph(index)) return glyphs[FONT_GLYPH_EMPTY];
+
+		glyphs[index].lastUsedFrame = glyphAtlasFrame;
+		return glyphs[index];
+	}
 };
 
+//Distance field glyphs are generated at this height with this many texels of falloff around the outline
+#define FONT_SDF_PIXEL_HEIGHT	48
+#define FONT_SDF_PADDING		6
+#define FONT_SDF_EDGE_VALUE		128
+
 Font* LoadFont(std::string filePath, u32 pixelHeight);
+//Returns a signed distance field font, one per typeface that stays sharp at any text size. Draw it with text_sdf.frag
+Font* LoadFontSDF(std::string filePath);
+
+//Async versions of the above, the font is a copy of the placeholder font until it has loaded
+Font* LoadFontAsync(std::string filePath, u32 pixelHeight);
+Font* LoadFontSDFAsync(std::string filePath);
+void SetPlaceholderFont(Font* font);
+
+#define RESOURCE_LOADER_THREADS		2
+#define RESOURCE_UPLOAD_BUDGET_MS	2.f
+
+//Finishes resources decoded on worker threads, spending roughly budgetMs on GL uploads. Called once per frame by RunGame
+void UpdateResourceLoading(float budgetMs = RESOURCE_UPLOAD_BUDGET_MS);
+u32 GetPendingResourceCount();
+
+//Watches the files LoadTexture and LoadShader read from the res folder and reloads them in place when they are saved,
+//textures are decoded on the loader threads. Packed resources aren't watched. On by default in debug builds
+void EnableResourceHotReload(bool enable);
+//Called once per frame by RunGame
+void UpdateResourceHotReload();
+
+//Generational handles to managed resources. Acquire loads on first use and adds a reference, Get returns nullptr once
+//the resource has been unloaded. Textures nobody holds a reference to are unloaded least recently used first when
+//texture memory goes over the budget. Resources only ever fetched with LoadTexture/LoadFont are never unloaded, so
+//don't keep raw pointers to anything that is managed through handles
+struct TextureHandle
+{
+	u32 index = 0;
+	u32 generation = 0;
+};
+
+struct FontHandle
+{
+	u32 index = 0;
+	u32 generation = 0;
+};
+
+TextureHandle AcquireTexture(std::string filenameAndPath);
+void ReleaseTexture(TextureHandle handle);
+Texture* GetTexture(TextureHandle handle);
+bool UnloadTexture(TextureHandle handle);
+
+FontHandle AcquireFont(std::string filePath, u32 pixelHeight);
+FontHandle AcquireFontSDF(std::string filePath);
+void ReleaseFont(FontHandle handle);
+Font* GetFont(FontHandle handle);
+bool UnloadFont(FontHandle handle);
+
+struct ResourceMemoryStats
+{
+	u64 textureBytes;
+	u64 glyphAtlasBytes;
+	u64 fontBytes; //Font files kept in memory for rasterising
+	u32 textureCount;
+	u32 fontCount;
+};
+
+//0 disables the budget, which is the default
+void SetTextureMemoryBudget(u64 bytes);
+ResourceMemoryStats GetResourceMemoryStats();
+//Called once per frame by RunGame, unloads textures while over budget
+void TrimResourceCache();
+
+//Called once per frame, compacts the glyph atlas if it filled up
+void UpdateGlyphAtlas();
+//Uploads the parts of the glyph atlas that were rasterised into since the last flush
+void FlushGlyphAtlas();
+u32 GetGlyphAtlasGeneration();
 
 struct TextRenderInfo
 {
@@ -372,6 +850,13 @@ struct TextRenderInfo
 	float lineHeightInPixels;
 };
 
+//Glyph quads relative to the text position, so a layout can be drawn anywhere
+struct TextLayout
+{
+	std::vector<FontCharacterRect> glyphRects;
+	TextRenderInfo info;
+};
+
 struct Text
 {
 	std::string data = "";
@@ -393,8 +878,17 @@ struct TextBatch : RenderBatch
 
 	void PushText(const Text& text);
 	void PushText(const Text& text, TextRenderInfo& info);
+	void PushTextCached(const Text& text);
+	void PushTextCached(const Text& text, TextRenderInfo& info);
+	void PushTextLayout(const TextLayout& layout, vec3 position, vec4 color);
 };
 
+void LayoutText(const Text& text, TextLayout& layout);
+
+//Returns a layout for the text, laid out on first use and reused while the string, font, size, extents and alignment stay the same
+const TextLayout& GetCachedTextLayout(const Text& text);
+void TrimTextLayoutCache();
+
 struct RenderQueue
 {
 	//TODO: Perhaps this should allow more control. Could be more flexible if I split up everything that happens in Clear()
@@ -409,8 +903,12 @@ struct RenderQueue
 	{
 		i32 spriteBatchIndex = -1;
 		i32 textBatchIndex = -1;
+		i32 sdfTextBatchIndex = -1;
 		void(*preDraw)();
 		void(*postDraw)();
+		bool scissor = false;
+		vec2 scissorPos;
+		vec2 scissorSize;
 	};
 
 	std::vector<Step> steps;
@@ -419,6 +917,7 @@ struct RenderQueue
 	//VertBuffer* buffer;
 	Shader* spriteShader;
 	Shader* textShader;
+	Shader* sdfTextShader = nullptr; //Used for text in SDF fonts, falls back to textShader when unset
 	SpriteSheet* spriteSheet;
 	Font* font;
 
@@ -427,35 +926,237 @@ struct RenderQueue
 	void Clear();
 	void AddStep();
 	void AddStep(void(*preDraw)(), void(*postDraw)());
+	void SetScissor(vec2 pos, vec2 size);
+	void ClearScissor();
 	void PushSprite(const Sprite& sprite);
 	void PushText(const Text& text);
 	void PushText(const Text& text, TextRenderInfo& info);
+	void PushTextCached(const Text& text);
+	void PushTextCached(const Text& text, TextRenderInfo& info);
+	TextBatch* GetTextBatch(bool sdf = false);
 	void Draw();
+
+	GLCallStats drawStats; //GL calls made by the last Draw
+};
+
+//Jobs
+//Workers are started on first use, the calling thread works through batches alongside them
+#define JOB_POOL_MAX_THREADS	8
+
+typedef Delegate<void(u32, u32)> JobRangeFunction;
+
+//Splits [0, count) into batchSize ranges run across the job pool and returns once all of them are done. Called from
+//inside a job it just runs the whole range on that thread
+void ParallelFor(u32 count, u32 batchSize, JobRangeFunction function);
+u32 GetJobThreadCount();
+
+//Entities
+#define ENTITY_PARALLEL_BATCH	256
+
+//Index 0 is never handed out, so a default Entity is null
+struct Entity
+{
+	u32 index = 0;
+	u32 generation = 0;
+
+	bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
 };
 
-//Entity
-// struct Entity
-// {
-// 	virtual void Tick() { }
-// 	virtual void Draw(SpriteBatch* batch) { }
-// };
-// 
-// struct Scene
-// {
-// 	std::vector<Entity> entities;
-// 
-// 	Scene();
-// 	void Draw();
-// };
-// 
-// struct TestEntity : Entity
-// {
-// 	void Tick() override;
-// 	void Draw(SpriteBatch* batch) override;
-// };
+//Sparse set, components are packed in one array with the entity each belongs to alongside. sparse maps an entity index
+//to its place in the packed arrays
+#define COMPONENT_NONE	UINT32_MAX
+
+struct ComponentPoolBase
+{
+	std::vector<u32> sparse;
+	std::vector<u32> entities;
+
+	virtual ~ComponentPoolBase() { }
+	virtual void Remove(u32 entity) = 0;
+
+	bool Has(u32 entity) const
+	{
+		return entity < sparse.size() && sparse[entity] != COMPONENT_NONE;
+	}
+
+	u32 Size() const
+	{
+		return (u32)entities.size();
+	}
+};
+
+template<typename T>
+struct ComponentPool : ComponentPoolBase
+{
+	std::vector<T> components;
+
+	T& Add(u32 entity, const T& value)
+	{
+		if (Has(entity)) return components[sparse[entity]] = value;
+		if (entity >= sparse.size()) sparse.resize(entity + 1, COMPONENT_NONE);
+
+		sparse[entity] = (u32)entities.size();
+		entities.push_back(entity);
+		components.push_back(value);
+		return components.back();
+	}
+
+	T& Get(u32 entity)
+	{
+		assert(Has(entity));
+		return components[sparse[entity]];
+	}
+
+	//Moves the last component into the gap so the arrays stay packed
+	void Remove(u32 entity) override
+	{
+		if (!Has(entity)) return;
+
+		u32 index = sparse[entity];
+		u32 last = (u32)entities.size() - 1;
+
+		components[index] = std::move(components[last]);
+		entities[index] = entities[last];
+		sparse[entities[index]] = index;
+		sparse[entity] = COMPONENT_NONE;
+
+		components.pop_back();
+		entities.pop_back();
+	}
+};
+
+u32 NextComponentTypeID();
+
+template<typename T>
+u32 ComponentTypeID()
+{
+	static u32 id = NextComponentTypeID();
+	return id;
+}
+
+//Built in collider, sized before the Transform2D scale is applied. Boxes ignore rotation
+#define COLLIDER_CIRCLE		0
+#define COLLIDER_AABB		1
+
+struct Collider
+{
+	u32 shape = COLLIDER_CIRCLE;
+	vec2 offset = vec2(0);
+	vec2 size = vec2(1); //Circles use size.x as the diameter
+	u32 layer = 1;
+	u32 mask = UINT32_MAX; //Layers this collider reports collisions with
+};
+
+struct CollisionPair
+{
+	Entity a, b;
+};
+
+//Worlds keep their Transform2D components as of the last fixed step, RunGame saves them before each step like the
+//transform store. DrawSprites blends between the two
+struct World
+{
+	std::vector<u32> generations;
+	std::vector<u32> freeEntities;
+	std::vector<std::unique_ptr<ComponentPoolBase>> pools; //Indexed by ComponentTypeID
+	std::vector<Transform2D> previousTransforms; //Indexed by entity
+	std::vector<u32> previousTransformGenerations; //Generation each was saved for, so new entities aren't blended
+
+	World();
+	~World();
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	Entity CreateEntity();
+	void DestroyEntity(Entity entity);
+	bool IsAlive(Entity entity) const;
+
+	template<typename T>
+	ComponentPool<T>& GetPool()
+	{
+		u32 id = ComponentTypeID<T>();
+		if (id >= pools.size()) pools.resize(id + 1);
+		if (pools[id] == nullptr) pools[id] = std::make_unique<ComponentPool<T>>();
+		return *static_cast<ComponentPool<T>*>(pools[id].get());
+	}
+
+	template<typename T>
+	T& AddComponent(Entity entity, const T& value = T())
+	{
+		assert(IsAlive(entity));
+		return GetPool<T>().Add(entity.index, value);
+	}
+
+	template<typename T>
+	void RemoveComponent(Entity entity)
+	{
+		if (IsAlive(entity)) GetPool<T>().Remove(entity.index);
+	}
+
+	template<typename T>
+	bool HasComponent(Entity entity)
+	{
+		return IsAlive(entity) && GetPool<T>().Has(entity.index);
+	}
+
+	//Null if the entity doesn't have one
+	template<typename T>
+	T* GetComponent(Entity entity)
+	{
+		ComponentPool<T>& pool = GetPool<T>();
+		if (!IsAlive(entity) || !pool.Has(entity.index)) return nullptr;
+		return &pool.Get(entity.index);
+	}
+
+	//Calls function(Entity, T&, Others&...) for every entity with all the listed components. Walks T's packed array in
+	//order so put the rarest component first. Components mustn't be added or removed until it returns
+	template<typename T, typename... Others, typename F>
+	void Each(F&& function)
+	{
+		EachInRange<T, Others...>(function, 0, GetPool<T>().Size());
+	}
+
+	//Each split into batches across the job pool. The function runs on several threads at once, so it should only
+	//write to the components it is handed
+	template<typename T, typename... Others, typename F>
+	void EachParallel(F&& function, u32 batchSize = ENTITY_PARALLEL_BATCH)
+	{
+		//Pools are created up front, the workers then only ever read the pool list
+		(GetPool<T>(), ..., GetPool<Others>());
+
+		ParallelFor(GetPool<T>().Size(), batchSize, [this, &function](u32 begin, u32 end) {
+			EachInRange<T, Others...>(function, begin, end);
+		});
+	}
+
+	//Built in systems, entities need a Transform2D as well
+	void SaveTransforms();
+	Transform2D GetInterpolatedTransform(Entity entity, const Transform2D& current) const;
+	void DrawSprites(SpriteBatch& batch);
+	void FindCollisions(std::vector<CollisionPair>& pairs);
+
+private:
+	template<typename T, typename... Others, typename F>
+	void EachInRange(F& function, u32 begin, u32 end)
+	{
+		ComponentPool<T>& pool = GetPool<T>();
+		std::tuple<ComponentPool<Others>*...> others(&GetPool<Others>()...);
+
+		for (u32 i = begin; i < end; i++)
+		{
+			u32 entity = pool.entities[i];
+			if (!(true && ... && std::get<ComponentPool<Others>*>(others)->Has(entity))) continue;
+
+			function(Entity{ entity, generations[entity] }, pool.components[i], std::get<ComponentPool<Others>*>(others)->Get(entity)...);
+		}
+	}
+};
+
+//Calls SaveTransforms on every World, RunGame does this before each fixed step
+void SaveWorldTransforms();
 
 //Input
-//TODO: Add rest of keyboard
 #define MOUSE_LEFT			0
 #define MOUSE_RIGHT			1
 #define MOUSE_MIDDLE		2
@@ -552,8 +1253,75 @@ struct RenderQueue
 #define KEY_F10				87
 #define KEY_F11				88
 #define KEY_F12				89
-
-#define KEY_LAST			90
+#define KEY_F13				90
+#define KEY_F14				91
+#define KEY_F15				92
+#define KEY_F16				93
+#define KEY_F17				94
+#define KEY_F18				95
+#define KEY_F19				96
+#define KEY_F20				97
+#define KEY_F21				98
+#define KEY_F22				99
+#define KEY_F23				100
+#define KEY_F24				101
+#define KEY_F25				102
+
+#define KEY_KP_0			103
+#define KEY_KP_1			104
+#define KEY_KP_2			105
+#define KEY_KP_3			106
+#define KEY_KP_4			107
+#define KEY_KP_5			108
+#define KEY_KP_6			109
+#define KEY_KP_7			110
+#define KEY_KP_8			111
+#define KEY_KP_9			112
+#define KEY_KP_DECIMAL		113
+#define KEY_KP_DIVIDE		114
+#define KEY_KP_MULTIPLY		115
+#define KEY_KP_SUBTRACT		116
+#define KEY_KP_ADD			117
+#define KEY_KP_ENTER		118
+#define KEY_KP_EQUAL		119
+
+#define KEY_SUPER_LEFT		120
+#define KEY_SUPER_RIGHT		121
+#define KEY_MENU			122
+#define KEY_WORLD_1			123
+#define KEY_WORLD_2			124
+
+//Gamepad buttons, in GLFW_GAMEPAD_BUTTON order. Only the first connected gamepad is read
+#define GAMEPAD_A					125
+#define GAMEPAD_B					126
+#define GAMEPAD_X					127
+#define GAMEPAD_Y					128
+#define GAMEPAD_LEFT_BUMPER			129
+#define GAMEPAD_RIGHT_BUMPER		130
+#define GAMEPAD_BACK				131
+#define GAMEPAD_START				132
+#define GAMEPAD_GUIDE				133
+#define GAMEPAD_LEFT_THUMB			134
+#define GAMEPAD_RIGHT_THUMB			135
+#define GAMEPAD_DPAD_UP				136
+#define GAMEPAD_DPAD_RIGHT			137
+#define GAMEPAD_DPAD_DOWN			138
+#define GAMEPAD_DPAD_LEFT			139
+
+//Stick directions and triggers pushed past GAMEPAD_AXIS_PRESS_THRESHOLD act as buttons too, released once they drop
+//back under GAMEPAD_AXIS_RELEASE_THRESHOLD
+#define GAMEPAD_LEFT_STICK_LEFT		140
+#define GAMEPAD_LEFT_STICK_RIGHT	141
+#define GAMEPAD_LEFT_STICK_UP		142
+#define GAMEPAD_LEFT_STICK_DOWN		143
+#define GAMEPAD_RIGHT_STICK_LEFT	144
+#define GAMEPAD_RIGHT_STICK_RIGHT	145
+#define GAMEPAD_RIGHT_STICK_UP		146
+#define GAMEPAD_RIGHT_STICK_DOWN	147
+#define GAMEPAD_LEFT_TRIGGER		148
+#define GAMEPAD_RIGHT_TRIGGER		149
+
+#define KEY_LAST			150
 
 #define KEY_MOD_NONE		0
 #define KEY_MOD_CONTROL		1
@@ -566,13 +1334,14 @@ enum InputState
 	PRESS, HOLD, RELEASE, UP
 };
 
-typedef std::function<void(void)> InputCallback;
+typedef Delegate<void(void)> InputCallback;
 
 struct InputEvent
 {
 	u32 key;
 	InputState state;
 	u32 modifier;
+	double time = 0.0; //glfwGetTime when the event came in
 
 	bool operator==(const InputEvent& other) const
 	{
@@ -587,28 +1356,31 @@ struct InputEvent
 	}
 };
 
-struct InputEventKeyHasher
-{
-	std::size_t operator()(const InputEvent& ie) const
-	{
-		return ((std::hash<u32>()(ie.key)
-			 ^ (std::hash<InputState>()(ie.state) << 1)) >> 1)
-			 ^ (std::hash<u32>()(ie.modifier) << 1);
-	}
-};
+//Named events are interned to an id when bound, so firing one never touches the name
+#define NAMED_EVENT_NONE	0
+
+u32 GetNamedEventID(const std::string& name);
 
 struct InputBinding
 {
 	InputCallback callback;
-	std::string eventName;
+	u32 eventID;
 	bool blocking;
 };
 
+struct InputKeyBinding
+{
+	InputState state;
+	u32 modifier;
+	InputBinding binding;
+};
+
 struct InputListener
 {
-	std::unordered_map<InputEvent, InputBinding, InputEventKeyHasher> bindings;
-	std::unordered_map<std::string, InputCallback> namedEvents;
-	std::function<void(u32)> onCharacterTyped;
+	//Indexed by key, a key rarely has more than a couple of bindings so they are searched in order
+	std::vector<InputKeyBinding> keyBindings[KEY_LAST];
+	std::vector<InputCallback> namedEvents; //Indexed by named event id
+	Delegate<void(u32)> onCharacterTyped;
 	i32 priority;
 	bool blocking;
 
@@ -637,13 +1409,45 @@ extern vec2 mouseDelta;
 extern vec3 mouseWorldDelta;
 
 void InitializeInput(GLFWwindow* window);
+//Events wait in a fixed size ring until they are dispatched, anything past this many in one frame is dropped
+#define INPUT_EVENT_RING_SIZE	256
+
 void UpdateInput(GLFWwindow* window, float dt);
+//Dispatches only the events that came in at or before time, later ones wait for the next update
+void UpdateInputUntil(GLFWwindow* window, double time);
+//Analog gamepad axes after deadzone filtering. Sticks go from -1 to 1 with up positive, triggers from 0 to 1
+#define GAMEPAD_AXIS_LEFT_X			0
+#define GAMEPAD_AXIS_LEFT_Y			1
+#define GAMEPAD_AXIS_RIGHT_X		2
+#define GAMEPAD_AXIS_RIGHT_Y		3
+#define GAMEPAD_AXIS_LEFT_TRIGGER	4
+#define GAMEPAD_AXIS_RIGHT_TRIGGER	5
+#define GAMEPAD_AXIS_COUNT			6
+
+#define GAMEPAD_STICK_DEADZONE			0.2f
+#define GAMEPAD_TRIGGER_DEADZONE		0.1f
+#define GAMEPAD_AXIS_PRESS_THRESHOLD	0.5f
+#define GAMEPAD_AXIS_RELEASE_THRESHOLD	0.4f
+
+float GetGamepadAxis(u32 axis);
+bool IsGamepadConnected();
+
 void RegisterInputListener(InputListener* listener);
 void UnregisterInputListener(InputListener* listener);
 std::string GetInputBindingName(u32 binding);
 
+//Input recording, logs the key events, typed characters, mouse position and frame times RunGame sees. Replaying a log
+//feeds them back in place of the real input and clock, so the session runs the same way as fast as it can draw
+bool StartInputRecording(std::string filePath);
+void StopInputRecording();
+bool StartInputReplay(std::string filePath, bool exitWhenFinished = true);
+bool IsRecordingInput();
+bool IsReplayingInput();
+//Called once per frame by RunGame, returns the frame time to use
+float RecordFrameTime(float dt);
+
 //GUI
-enum GUIWidgetComponent { GUI_NONE, GUI_IMAGE, GUI_LABEL, GUI_BUTTON, GUI_TICKBOX, GUI_SLIDER, GUI_TEXT_FIELD, GUI_FLOAT_FIELD, GUI_ROW, GUI_COLUMN };
+enum GUIWidgetComponent { GUI_NONE, GUI_IMAGE, GUI_LABEL, GUI_BUTTON, GUI_TICKBOX, GUI_SLIDER, GUI_TEXT_FIELD, GUI_FLOAT_FIELD, GUI_ROW, GUI_COLUMN, GUI_LIST_VIEW };
 enum GUIImageSource { BLOCK, BOX, CROSS, TICK, MINUS, PLUS, ARROW_UP, ARROW_RIGHT, ARROW_DOWN, ARROW_LEFT, GLASS, TEXT_FIELD_BG };
 
 struct GUIWidget
@@ -655,6 +1459,8 @@ struct GUIWidget
 	vec2 pivot;
 	vec2 anchor;
 	Edges margin;
+	vec2 clipMin;
+	vec2 clipMax;
 	bool sizeXSet;
 	bool sizeYSet;
 	bool marginLeftSet;
@@ -675,6 +1481,8 @@ struct GUIWidget
 		pivot = TOP_LEFT;
 		anchor = TOP_LEFT;
 		margin = Edges::Zero();
+		clipMin = vec2(-FLT_MAX);
+		clipMax = vec2(FLT_MAX);
 		sizeXSet = false;
 		sizeYSet = false;
 		marginLeftSet = false;
@@ -726,12 +1534,12 @@ struct GUIButton
 	vec4 hoverColor;
 	vec4 pressColor;
 	Edges nineSliceMargin;
-	std::function<void(void)> onHoverEnter;
-	std::function<void(void)> onHover;
-	std::function<void(void)> onHoverExit;
-	std::function<void(void)> onPress;
-	std::function<void(void)> onHold;
-	std::function<void(void)> onRelease;
+	InputCallback onHoverEnter;
+	InputCallback onHover;
+	InputCallback onHoverExit;
+	InputCallback onPress;
+	InputCallback onHold;
+	InputCallback onRelease;
 
 	GUIButton()
 	{
@@ -832,7 +1640,7 @@ struct GUIFloatField
 	Font* font;
 	std::string text;
 	float* value;
-	std::function<void(float)> onValueChanged;
+	Delegate<void(float)> onValueChanged;
 	float textHeightInPixels;
 	float min;
 	float max;
@@ -879,6 +1687,36 @@ struct GUIColumn
 	}
 };
 
+//Virtualised list, only the rows within the visible range (plus overscan) should be emitted as children.
+//Scroll state persists between frames, rows without a set height use rowHeight, which is also the estimate used for ranges
+struct GUIListView
+{
+	u32 itemCount;
+	u32 overscan;
+	float rowHeight;
+	float scroll;
+	float offset;
+	float viewHeight;
+	u32 firstVisible;
+	u32 lastVisible;
+	u32 renderBegin;
+	u32 renderEnd;
+
+	GUIListView()
+	{
+		itemCount = 0;
+		overscan = 2;
+		rowHeight = 30.f;
+		scroll = 0.f;
+		offset = 0.f;
+		viewHeight = 0.f;
+		firstVisible = 0;
+		lastVisible = 0;
+		renderBegin = 0;
+		renderEnd = 0;
+	}
+};
+
 struct GUIContext
 {
 	SpriteSheet spriteSheet;
@@ -897,6 +1735,9 @@ struct GUIContext
 	GUIFloatField defaultFloatField;
 	GUIRow defaultRow;
 	GUIColumn defaultColumn;
+	GUIListView defaultListView;
+
+	GLCallStats drawStats; //GL calls made drawing the GUI last frame
 
 	void Start();
 	void EndAndDraw();
@@ -912,6 +1753,7 @@ struct GUIContext
 	void _FloatField(u64 id);
 	void _Row(u64 id);
 	void _Column(u64 id);
+	void _ListView(u64 id);
 
 	void pos(vec2 pos);
 	void posX(float x);
@@ -939,12 +1781,12 @@ struct GUIContext
 
 	void hoverColor(vec4 color);
 	void pressColor(vec4 color);
-	void onHoverEnter(std::function<void(void)> onHoverEnter);
-	void onHover(std::function<void(void)> onHover);
-	void onHoverExit(std::function<void(void)> onHoverExit);
-	void onPress(std::function<void(void)> onPress);
-	void onHold(std::function<void(void)> onHold);
-	void onRelease(std::function<void(void)> onRelease);
+	void onHoverEnter(InputCallback onHoverEnter);
+	void onHover(InputCallback onHover);
+	void onHoverExit(InputCallback onHoverExit);
+	void onPress(InputCallback onPress);
+	void onHold(InputCallback onHold);
+	void onRelease(InputCallback onRelease);
 
 	void min(float min);
 	void max(float max);
@@ -952,10 +1794,15 @@ struct GUIContext
 	void value(bool* value);
 	void value(float* value);
 	void value(std::string* value);
-	void onValueChanged(std::function<void(float)> onValueChanged);
+	void onValueChanged(Delegate<void(float)> onValueChanged);
 
 	void spacing(float spacing);
 
+	void itemCount(u32 itemCount);
+	void rowHeight(float rowHeight);
+	void overscan(u32 overscan);
+	void visibleRange(u32& first, u32& last);
+
 	void EndNode();
 
 	void BuildWidget(u64 id);
@@ -996,6 +1843,9 @@ extern GUIContext globalGUIContext;
 #define ColumnKey(key) _Column(std::hash<std::string>{}(std::string(__FILE__) + std::to_string(__LINE__) + key))
 #define Column() _Column(std::hash<std::string>{}(std::string(__FILE__) + std::to_string(__LINE__)))
 
+#define ListViewKey(key) _ListView(std::hash<std::string>{}(std::string(__FILE__) + std::to_string(__LINE__) + key))
+#define ListView() _ListView(std::hash<std::string>{}(std::string(__FILE__) + std::to_string(__LINE__)))
+
 //Collision
 struct Circle
 {
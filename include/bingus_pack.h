@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+//Resource pack layout shared by the bingus_pack tool and the runtime loader. A pack is a header, then a table of
+//entries, then the entry data. Data blocks are aligned so they can be handed to GL straight from a mapped file
+
+#define BINGUS_PACK_MAGIC		0x4B504742 //"BGPK"
+#define BINGUS_PACK_VERSION		1
+#define BINGUS_PACK_ALIGNMENT	64
+#define BINGUS_PACK_NAME_LENGTH	112
+
+enum BingusPackEntryType : uint32_t { BINGUS_PACK_TEXTURE, BINGUS_PACK_SHADER, BINGUS_PACK_FONT, BINGUS_PACK_TYPE_COUNT };
+
+struct BingusPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+};
+
+struct BingusPackEntry
+{
+	char name[BINGUS_PACK_NAME_LENGTH]; //Same name LoadTexture/LoadShader/LoadFont are called with
+	uint32_t type;
+
+	//Textures are RGBA8, flipped for GL, with every mip level stored back to back starting at the full size
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+
+	uint64_t offset; //From the start of the file
+	uint64_t size;
+};
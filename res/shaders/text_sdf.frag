@@ -0,0 +1,17 @@
+#version 420 core
+
+in vec2 uv;
+in vec4 color;
+
+uniform sampler2D main_tex;
+
+out vec4 frag_color;
+
+void main()
+{
+    //Distance is stored with the outline at 0.5, smooth across one screen pixel so edges stay crisp at any scale
+    float distance = texture(main_tex, uv).r;
+    float smoothing = fwidth(distance) * 0.5;
+    float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+    frag_color = vec4(color.rgb, alpha * color.a);
+}
@@ -1,5 +1,9 @@
 #include "bingus.h"
 
+#include <thread>
+#include <chrono>
+#include <deque>
+
 //Game Events
 static bool exitGameCalled;
 
@@ -36,6 +40,10 @@ static float gameTime = 0.f;
 static float stepAccumulator = 0.f;
 static float timestep = 1.f / 60.f;
 static float timestepAlpha = 0.f;
+static float baseTimestep = 1.f / 60.f; //Timestep set by the game, adaptive mode only ever raises it from here
+static bool adaptiveTimestep = false;
+static float maxAdaptiveTimestep = 1.f / 20.f;
+static float stepCostAverage = 0.f;
 
 float GetDeltaTime()
 {
@@ -57,8 +65,16 @@ u32 GetFPS()
 	return framesPerSecond;
 }
 
+static bool subframeInput = false;
+
+void SetSubframeInput(bool enabled)
+{
+	subframeInput = enabled;
+}
+
 void SetFixedTimestep(float _timestep)
 {
+	baseTimestep = _timestep;
 	timestep = _timestep;
 }
 
@@ -72,38 +88,154 @@ float GetTimestepAlpha()
 	return timestepAlpha;
 }
 
+void SetAdaptiveTimestep(bool enabled, float maxTimestep)
+{
+	adaptiveTimestep = enabled;
+	maxAdaptiveTimestep = glm::max(maxTimestep, baseTimestep);
+	if (!enabled) timestep = baseTimestep;
+}
+
+static void AdaptTimestep(float stepCost)
+{
+	stepCostAverage = glm::mix(stepCostAverage, stepCost, 0.1f);
+
+	//Fraction of real time spent simulating at the current rate
+	float load = stepCostAverage / timestep;
+
+	if (load > ADAPTIVE_TIMESTEP_HIGH_LOAD) timestep = glm::min(timestep * 1.1f, maxAdaptiveTimestep);
+	else if (load < ADAPTIVE_TIMESTEP_LOW_LOAD) timestep = glm::max(timestep / 1.1f, baseTimestep);
+}
+
+//Interpolated transforms
+static std::vector<Transform2D> currentTransforms;
+static std::vector<Transform2D> previousTransforms;
+static std::vector<u32> freeTransforms;
+static std::vector<bool> transformsInUse;
+
+u32 CreateTransform(const Transform2D& transform)
+{
+	u32 index;
+
+	if (!freeTransforms.empty())
+	{
+		index = freeTransforms.back();
+		freeTransforms.pop_back();
+	}
+	else
+	{
+		index = (u32)currentTransforms.size();
+		currentTransforms.emplace_back();
+		previousTransforms.emplace_back();
+		transformsInUse.push_back(false);
+	}
+
+	transformsInUse[index] = true;
+	TeleportTransform(index, transform);
+	return index;
+}
+
+void DestroyTransform(u32 transform)
+{
+	assert(transform < currentTransforms.size());
+	assert(transformsInUse[transform] && "Transform destroyed twice");
+
+	//A second destroy would hand the same index out twice
+	if (!transformsInUse[transform]) return;
+
+	transformsInUse[transform] = false;
+	freeTransforms.push_back(transform);
+}
+
+Transform2D& GetTransform(u32 transform)
+{
+	assert(transform < currentTransforms.size());
+	return currentTransforms[transform];
+}
+
+void TeleportTransform(u32 transform, const Transform2D& value)
+{
+	assert(transform < currentTransforms.size());
+	currentTransforms[transform] = value;
+	previousTransforms[transform] = value;
+}
+
+Transform2D GetInterpolatedTransform(u32 transform)
+{
+	assert(transform < currentTransforms.size());
+	return InterpolateTransform(previousTransforms[transform], currentTransforms[transform], timestepAlpha);
+}
+
+Transform2D InterpolateTransform(const Transform2D& previous, const Transform2D& current, float alpha)
+{
+	//Rotation takes the short way round
+	float rotationDelta = glm::mod(current.rotation - previous.rotation + 540.f, 360.f) - 180.f;
+
+	Transform2D result;
+	result.position = glm::mix(previous.position, current.position, alpha);
+	result.rotation = previous.rotation + rotationDelta * alpha;
+	result.scale = glm::mix(previous.scale, current.scale, alpha);
+	return result;
+}
+
 //Timers
-static std::vector<Timer*> timers;
+static std::deque<Timer> timerPool; //Deque so handed out pointers stay put as it grows
+static std::vector<Timer*> freeTimers;
+static double timerClock = 0.0;
 
 Timer* CreateTimer()
 {
-	Timer* timer = new Timer();
-	timer->timeElapsed = 0.f;
+	Timer* timer;
+
+	if (!freeTimers.empty())
+	{
+		timer = freeTimers.back();
+		freeTimers.pop_back();
+	}
+	else
+	{
+		timer = &timerPool.emplace_back();
+	}
+
+	timer->elapsedAtStart = 0.f;
+	timer->startTime = timerClock;
 	timer->speed = 1.f;
 	timer->paused = false;
-	timers.push_back(timer);
 	return timer;
 }
 
-Timer::~Timer()
+void DestroyTimer(Timer* timer)
 {
-	//Remove from global list upon destruction
-	auto it = timers.begin();
-	while (it != timers.end())
-	{
-		if (*it == this) break;
-	}
-	
-	if (it != timers.end()) timers.erase(it);
+	freeTimers.push_back(timer);
+}
+
+float Timer::GetTimeElapsed() const
+{
+	if (paused) return elapsedAtStart;
+	return elapsedAtStart + (float)(timerClock - startTime) * speed;
+}
+
+void Timer::SetTimeElapsed(float time)
+{
+	elapsedAtStart = time;
+	startTime = timerClock;
+}
+
+void Timer::SetSpeed(float speed)
+{
+	SetTimeElapsed(GetTimeElapsed());
+	this->speed = speed;
 }
 
 void Timer::Reset()
 {
-	timeElapsed = 0.f;
+	SetTimeElapsed(0.f);
 }
 
 void Timer::Pause()
 {
+	if (paused) return;
+
+	elapsedAtStart = GetTimeElapsed();
 	paused = true;
 }
 
@@ -115,9 +247,216 @@ void Timer::Stop()
 
 void Timer::Play()
 {
+	if (!paused) return;
+
+	startTime = timerClock;
 	paused = false;
 }
 
+//Timer wheel. Nodes link into their slot by index, index 0 is never handed out so it doubles as the end of a list
+#define TIMER_WHEEL_SLOT_MASK	(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_NO_SLOT		0xFFFF
+
+struct TimerWheelNode
+{
+	TimerCallback callback;
+	u64 deadline; //In ticks
+	u32 interval; //Ticks between repeats, 0 fires once
+	u32 generation;
+	u32 prev;
+	u32 next;
+	u16 slot;
+};
+
+static std::vector<TimerWheelNode> timerNodes(1);
+static std::vector<u32> freeTimerNodes;
+static u32 timerSlots[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+static u64 timerWheelTick = 0;
+static double timerWheelRemainder = 0.0;
+static u32 scheduledTimerCount = 0;
+
+static void LinkTimerNode(u32 index)
+{
+	TimerWheelNode& node = timerNodes[index];
+	u64 tick = timerWheelTick;
+
+	//The level is the highest base-TIMER_WHEEL_SLOTS digit the deadline differs from now in, the slot is that digit
+	u32 level = 0;
+	for (u64 difference = (node.deadline ^ tick) >> TIMER_WHEEL_SLOT_BITS; difference != 0; difference >>= TIMER_WHEEL_SLOT_BITS)
+	{
+		level++;
+	}
+
+	u32 slot;
+	if (level < TIMER_WHEEL_LEVELS)
+	{
+		slot = (node.deadline >> (level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+	}
+	else
+	{
+		//Across the top level rolling over. Slot 0 of the top level is only visited at the rollover, as every other
+		//deadline there is ahead of now, so it holds these until they can be placed properly
+		level = TIMER_WHEEL_LEVELS - 1;
+		slot = 0;
+	}
+
+	node.slot = (u16)(level * TIMER_WHEEL_SLOTS + slot);
+	node.prev = 0;
+	node.next = timerSlots[node.slot];
+	if (node.next != 0) timerNodes[node.next].prev = index;
+	timerSlots[node.slot] = index;
+}
+
+static void UnlinkTimerNode(u32 index)
+{
+	TimerWheelNode& node = timerNodes[index];
+
+	if (node.prev != 0) timerNodes[node.prev].next = node.next;
+	else timerSlots[node.slot] = node.next;
+	if (node.next != 0) timerNodes[node.next].prev = node.prev;
+
+	node.slot = TIMER_WHEEL_NO_SLOT;
+}
+
+static void FreeTimerNode(u32 index)
+{
+	TimerWheelNode& node = timerNodes[index];
+	node.callback = nullptr;
+	node.generation++;
+	freeTimerNodes.push_back(index);
+	scheduledTimerCount--;
+}
+
+static TimerHandle AddTimer(float delay, u32 interval, TimerCallback&& callback)
+{
+	u32 index;
+
+	if (!freeTimerNodes.empty())
+	{
+		index = freeTimerNodes.back();
+		freeTimerNodes.pop_back();
+	}
+	else
+	{
+		index = (u32)timerNodes.size();
+		timerNodes.emplace_back();
+		timerNodes.back().generation = 0;
+	}
+
+	//Never due before the next tick, so a callback scheduling another can't fire it in the same pass
+	u64 delayTicks = (u64)glm::max(delay / TIMER_WHEEL_TICK + 0.5, 1.0);
+
+	TimerWheelNode& node = timerNodes[index];
+	node.callback = std::move(callback);
+	node.deadline = timerWheelTick + delayTicks;
+	node.interval = interval;
+	LinkTimerNode(index);
+	scheduledTimerCount++;
+
+	return { index, node.generation };
+}
+
+TimerHandle ScheduleTimer(float delay, TimerCallback callback)
+{
+	return AddTimer(delay, 0, std::move(callback));
+}
+
+TimerHandle ScheduleRepeatingTimer(float interval, TimerCallback callback)
+{
+	u32 intervalTicks = (u32)glm::max(interval / TIMER_WHEEL_TICK + 0.5, 1.0);
+	return AddTimer(interval, intervalTicks, std::move(callback));
+}
+
+bool IsTimerScheduled(TimerHandle handle)
+{
+	return handle.index != 0 && handle.index < timerNodes.size()
+		&& timerNodes[handle.index].generation == handle.generation
+		&& timerNodes[handle.index].slot != TIMER_WHEEL_NO_SLOT;
+}
+
+void CancelTimer(TimerHandle handle)
+{
+	if (!IsTimerScheduled(handle)) return;
+
+	UnlinkTimerNode(handle.index);
+	FreeTimerNode(handle.index);
+}
+
+static void FireTimerSlot(u32 slot)
+{
+	//Taken from the head one at a time, callbacks can schedule and cancel timers in this same slot
+	while (timerSlots[slot] != 0)
+	{
+		u32 index = timerSlots[slot];
+		UnlinkTimerNode(index);
+
+		TimerWheelNode& node = timerNodes[index];
+		if (node.interval == 0)
+		{
+			TimerCallback callback = std::move(node.callback);
+			FreeTimerNode(index);
+			callback();
+		}
+		else
+		{
+			//Relinked before the call so the callback can cancel it, deadlines step in whole ticks so repeats don't drift
+			TimerCallback callback = node.callback;
+			node.deadline += node.interval;
+			LinkTimerNode(index);
+			callback();
+		}
+	}
+}
+
+static void CascadeTimerSlot(u32 slot)
+{
+	u32 index = timerSlots[slot];
+	timerSlots[slot] = 0;
+
+	while (index != 0)
+	{
+		u32 next = timerNodes[index].next;
+		LinkTimerNode(index);
+		index = next;
+	}
+}
+
+void AdvanceTimers(float dt)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	timerClock += dt;
+	timerWheelRemainder += dt;
+
+	u64 ticks = (u64)(timerWheelRemainder / TIMER_WHEEL_TICK);
+	timerWheelRemainder -= ticks * TIMER_WHEEL_TICK;
+
+	//Nothing scheduled, every slot is empty so the wheel can jump straight there
+	if (scheduledTimerCount == 0)
+	{
+		timerWheelTick += ticks;
+		return;
+	}
+
+	for (; ticks != 0; ticks--)
+	{
+		u64 tick = ++timerWheelTick;
+
+		//Each level's current slot gets spread down a level when every digit below it rolls over to zero
+		for (u32 level = TIMER_WHEEL_LEVELS - 1; level != 0; level--)
+		{
+			u32 shift = level * TIMER_WHEEL_SLOT_BITS;
+			if ((tick & ((1ull << shift) - 1)) != 0) continue;
+
+			CascadeTimerSlot(level * TIMER_WHEEL_SLOTS + (u32)((tick >> shift) & TIMER_WHEEL_SLOT_MASK));
+		}
+
+		FireTimerSlot((u32)(tick & TIMER_WHEEL_SLOT_MASK));
+	}
+}
+
 //Colors
 static vec4 clearColor;
 
@@ -126,6 +465,118 @@ void SetClearColor(vec4 color)
 	clearColor = color;
 }
 
+//Frame pacing
+static FramePacing framePacing = FRAME_PACING_VSYNC;
+static double frameCapInterval = 1.0 / 60.0;
+static double nextPresentTime = 0.0;
+static double lastPresentTime = 0.0;
+static double sleepOvershoot = FRAME_PACING_MIN_SPIN; //Average of how late sleep_for wakes up, sets how long to spin
+static float presentIntervals[FRAME_PACING_SAMPLES];
+static u32 presentIntervalIndex = 0;
+static u32 presentIntervalCount = 0;
+static FramePacingStats framePacingStats;
+
+void SetFramePacing(FramePacing mode, float targetFPS)
+{
+	framePacing = mode;
+	frameCapInterval = 1.0 / targetFPS;
+	nextPresentTime = glfwGetTime() + frameCapInterval;
+
+	switch (mode)
+	{
+	case FRAME_PACING_VSYNC:
+		glfwSwapInterval(1);
+		break;
+	case FRAME_PACING_ADAPTIVE_VSYNC:
+		if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			glfwSwapInterval(-1);
+		}
+		else
+		{
+			framePacing = FRAME_PACING_VSYNC;
+			glfwSwapInterval(1);
+		}
+		break;
+	default:
+		glfwSwapInterval(0);
+		break;
+	}
+}
+
+FramePacing GetFramePacing()
+{
+	return framePacing;
+}
+
+FramePacingStats GetFramePacingStats()
+{
+	return framePacingStats;
+}
+
+//Returns the time spent waiting
+static double WaitForFrameCap()
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	double start = glfwGetTime();
+
+	//More than a frame late, pace from now rather than rushing frames out to catch up
+	if (start - nextPresentTime > frameCapInterval) nextPresentTime = start;
+
+	//Sleep is coarse, so wake early by about as much as it usually oversleeps and spin the rest
+	double spin = glm::clamp(sleepOvershoot * 2.0, FRAME_PACING_MIN_SPIN, FRAME_PACING_MAX_SPIN);
+	double sleepUntil = nextPresentTime - spin;
+
+	if (sleepUntil > start)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(sleepUntil - start));
+		double overshoot = glm::max(glfwGetTime() - sleepUntil, 0.0);
+		sleepOvershoot = glm::mix(sleepOvershoot, overshoot, 0.1);
+	}
+
+	while (glfwGetTime() < nextPresentTime) std::this_thread::yield();
+
+	nextPresentTime += frameCapInterval;
+	return glfwGetTime() - start;
+}
+
+static void UpdateFramePacingStats(double presentTime, double waitTime)
+{
+	if (lastPresentTime != 0.0)
+	{
+		presentIntervals[presentIntervalIndex] = (float)(presentTime - lastPresentTime);
+		if (++presentIntervalIndex == FRAME_PACING_SAMPLES) presentIntervalIndex = 0;
+		if (presentIntervalCount < FRAME_PACING_SAMPLES) presentIntervalCount++;
+	}
+
+	lastPresentTime = presentTime;
+	framePacingStats.waitTime = (float)waitTime;
+	if (presentIntervalCount == 0) return;
+
+	float sum = 0.f;
+	float worst = 0.f;
+	for (u32 i = 0; i < presentIntervalCount; i++)
+	{
+		sum += presentIntervals[i];
+		worst = glm::max(worst, presentIntervals[i]);
+	}
+
+	float mean = sum / presentIntervalCount;
+	float variance = 0.f;
+	for (u32 i = 0; i < presentIntervalCount; i++)
+	{
+		float deviation = presentIntervals[i] - mean;
+		variance += deviation * deviation;
+	}
+
+	framePacingStats.presentInterval = mean;
+	framePacingStats.jitter = sqrtf(variance / presentIntervalCount);
+	framePacingStats.worstInterval = worst;
+}
+
 void BingusInit()
 {
 	InitializeRenderer();
@@ -133,6 +584,11 @@ void BingusInit()
 	InitializeDebug();
 	exitGameCalled = false;
 	clearColor = vec4(0, 0, 0, 1);
+	SetFramePacing(FRAME_PACING_VSYNC);
+
+#ifndef NDEBUG
+	EnableResourceHotReload(true);
+#endif
 
 	//Connect Live Plus Plus if enabled
 #ifdef LIVEPP_ENABLE
@@ -156,8 +612,10 @@ void SwapBuffers()
 #ifdef TRACY_ENABLE
 	ZoneScoped;
 #endif
-	glfwSwapInterval(1);
+
+	double waitTime = framePacing == FRAME_PACING_CAP ? WaitForFrameCap() : 0.0;
 	glfwSwapBuffers(GetWindow());
+	UpdateFramePacingStats(glfwGetTime(), waitTime);
 }
 
 void RunGame()
@@ -169,17 +627,22 @@ void RunGame()
 	//Game loop
 	while (!GameShouldExit())
 	{
+		double frameStart = glfwGetTime();
 		prevTime = gameTime;
-		gameTime = (float)glfwGetTime();
+		gameTime = (float)frameStart;
 		dt = gameTime - prevTime;
 
-		UpdateInput(GetWindow(), dt);
+		//A replay runs on the frame times it logged
+		dt = RecordFrameTime(dt);
+		if (IsReplayingInput()) gameTime = prevTime + dt;
 
-		//Update timers
-		for (auto it = timers.begin(); it != timers.end(); it++)
-		{
-			if (!(*it)->paused) (*it)->timeElapsed += dt * (*it)->speed;
-		}
+		//Subframe input is dispatched by the fixed steps below instead
+		if (!subframeInput) UpdateInput(GetWindow(), dt);
+		UpdateResourceHotReload();
+		UpdateResourceLoading();
+
+		AdvanceTimers(dt);
+		UpdateSpriteAnimations(dt);
 
 		globalGUIContext.Start();
 
@@ -187,17 +650,48 @@ void RunGame()
 		if (dt > 0.25f) dt = 0.25f;
 		stepAccumulator += dt;
 
+		//Step sizes depend on how long steps took, which a replay can't reproduce, so recording and replay both
+		//run at the base timestep
+		bool adaptSteps = adaptiveTimestep && !IsRecordingInput() && !IsReplayingInput();
+		if (!adaptSteps) timestep = baseTimestep;
+
+		u32 steps = 0;
 		while (stepAccumulator >= timestep)
 		{
-			if (fixedUpdateEvent != nullptr) fixedUpdateEvent(timestep);
-			stepAccumulator -= timestep;
+			if (adaptSteps && steps == ADAPTIVE_TIMESTEP_MAX_STEPS)
+			{
+				//Behind, drop the backlog rather than take even longer catching up
+				stepAccumulator = glm::mod(stepAccumulator, timestep);
+				break;
+			}
+
+			if (subframeInput)
+			{
+				//The steps catch the simulation up to frameStart, each takes the events from the slice of time it covers
+				glfwPollEvents();
+				UpdateInputUntil(GetWindow(), frameStart - stepAccumulator + timestep);
+			}
+
+			double stepStart = glfwGetTime();
+			float stepTimestep = timestep;
+
+			previousTransforms = currentTransforms;
+			SaveWorldTransforms();
+			if (fixedUpdateEvent != nullptr) fixedUpdateEvent(stepTimestep);
+			stepAccumulator -= stepTimestep;
+			steps++;
+
+			if (adaptSteps) AdaptTimestep((float)(glfwGetTime() - stepStart));
 		}
 
+		//Whatever came in after the last step's slice
+		if (subframeInput) UpdateInputUntil(GetWindow(), frameStart);
+
 		if (updateEvent != nullptr) updateEvent(dt);
 
 		//UpdateDebug();
 
-		timestepAlpha = stepAccumulator / timestep;
+		timestepAlpha = glm::min(stepAccumulator / timestep, 1.f);
 
 		//Draw
 		glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
@@ -208,6 +702,9 @@ void RunGame()
 
 		globalRenderQueue.Draw();
 		globalRenderQueue.Clear();
+		TrimTextLayoutCache();
+		UpdateGlyphAtlas();
+		TrimResourceCache();
 
 		DrawDebug(dt);
 
@@ -94,7 +94,7 @@ void InitializeDebug()
 	polyBatchScreen.drawMode = GL_TRIANGLES;
 
 	glLineWidth(3.f);
-	glEnable(GL_LINE_SMOOTH);
+	SetCapability(GL_LINE_SMOOTH, true);
 }
 
 void DrawDebugIcon(u32 space, u32 icon, vec3 position, float size, vec4 color, float timer)
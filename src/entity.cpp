@@ -1,25 +1,180 @@
 #include "bingus.h"
-#include <unordered_map>
 
-//static std::unordered_map<u32, 
+#include <algorithm>
+#include <atomic>
 
-Scene::Scene()
+u32 NextComponentTypeID()
 {
+	//A job can be the first to use a component type, so ids may be handed out from several threads at once
+	static std::atomic<u32> nextID = 0;
+	return nextID.fetch_add(1, std::memory_order_relaxed);
+}
+
+static std::vector<World*> worlds; //For SaveWorldTransforms
+
+World::World()
+{
+	//Index 0 stays unused so a default Entity never refers to anything
+	generations.push_back(0);
+	worlds.push_back(this);
+}
+
+World::~World()
+{
+	worlds.erase(std::find(worlds.begin(), worlds.end(), this));
+}
+
+void SaveWorldTransforms()
+{
+	for (World* world : worlds) world->SaveTransforms();
+}
 
+Entity World::CreateEntity()
+{
+	u32 index;
+
+	if (!freeEntities.empty())
+	{
+		index = freeEntities.back();
+		freeEntities.pop_back();
+	}
+	else
+	{
+		index = (u32)generations.size();
+		generations.push_back(0);
+	}
+
+	return { index, generations[index] };
 }
 
-void Scene::Draw()
+void World::DestroyEntity(Entity entity)
 {
+	if (!IsAlive(entity)) return;
 
+	for (std::unique_ptr<ComponentPoolBase>& pool : pools)
+	{
+		if (pool != nullptr) pool->Remove(entity.index);
+	}
+
+	//Bumping the generation makes any handles still held to it stale
+	generations[entity.index]++;
+	freeEntities.push_back(entity.index);
 }
 
-void TestEntity::Tick()
+bool World::IsAlive(Entity entity) const
 {
-	
+	return entity.index != 0 && entity.index < generations.size() && generations[entity.index] == entity.generation;
 }
 
-void TestEntity::Draw(SpriteBatch* batch)
+void World::SaveTransforms()
 {
-	//Sprite sprite Sprite()
-	//batch->PushSprite();
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	previousTransforms.resize(generations.size());
+	previousTransformGenerations.resize(generations.size(), UINT32_MAX);
+
+	ComponentPool<Transform2D>& pool = GetPool<Transform2D>();
+	for (u32 i = 0; i < pool.Size(); i++)
+	{
+		u32 entity = pool.entities[i];
+		previousTransforms[entity] = pool.components[i];
+		previousTransformGenerations[entity] = generations[entity];
+	}
+}
+
+//Entities that got their transform since the last step haven't got a previous state, they are drawn where they are
+Transform2D World::GetInterpolatedTransform(Entity entity, const Transform2D& current) const
+{
+	if (entity.index >= previousTransformGenerations.size() || previousTransformGenerations[entity.index] != entity.generation)
+	{
+		return current;
+	}
+
+	return InterpolateTransform(previousTransforms[entity.index], current, GetTimestepAlpha());
+}
+
+void World::DrawSprites(SpriteBatch& batch)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	Each<Sprite, Transform2D>([&](Entity entity, Sprite& sprite, Transform2D& transform) {
+		Transform2D drawn = GetInterpolatedTransform(entity, transform);
+
+		Sprite placed = sprite;
+		placed.transform = TRANSFORM_NONE; //Placed by the component, not the transform store
+		placed.position = drawn.position;
+		placed.rotation = drawn.rotation;
+		placed.size *= drawn.scale;
+		batch.PushSprite(placed);
+	});
+}
+
+//World space bounds of a collider, sorted on min.x for the sweep
+struct ColliderBounds
+{
+	AABB box;
+	Circle circle;
+	Entity entity;
+	u32 shape;
+	u32 layer;
+	u32 mask;
+};
+
+static std::vector<ColliderBounds> colliderBounds;
+
+static bool TestColliders(const ColliderBounds& a, const ColliderBounds& b)
+{
+	if (a.shape == COLLIDER_CIRCLE && b.shape == COLLIDER_CIRCLE) return TestCircleCircle(a.circle, b.circle);
+	if (a.shape == COLLIDER_AABB && b.shape == COLLIDER_AABB) return true; //Bounds already overlap
+	if (a.shape == COLLIDER_CIRCLE) return TestCircleAABB(a.circle, b.box);
+	return TestCircleAABB(b.circle, a.box);
+}
+
+void World::FindCollisions(std::vector<CollisionPair>& pairs)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	pairs.clear();
+	colliderBounds.clear();
+
+	Each<Collider, Transform2D>([&](Entity entity, Collider& collider, Transform2D& transform) {
+		ColliderBounds bounds;
+		vec2 center = vec2(transform.position.x, transform.position.y) + collider.offset * transform.scale;
+		vec2 halfSize = collider.size * transform.scale * 0.5f;
+
+		if (collider.shape == COLLIDER_CIRCLE) halfSize = vec2(halfSize.x);
+
+		bounds.box = AABB(center - halfSize, center + halfSize);
+		bounds.circle = Circle(center, halfSize.x);
+		bounds.entity = entity;
+		bounds.shape = collider.shape;
+		bounds.layer = collider.layer;
+		bounds.mask = collider.mask;
+		colliderBounds.push_back(bounds);
+	});
+
+	//Sort and sweep, only colliders whose x ranges overlap are ever compared
+	std::sort(colliderBounds.begin(), colliderBounds.end(), [](const ColliderBounds& a, const ColliderBounds& b) {
+		return a.box.min.x < b.box.min.x;
+	});
+
+	for (size_t i = 0; i < colliderBounds.size(); i++)
+	{
+		const ColliderBounds& a = colliderBounds[i];
+
+		for (size_t j = i + 1; j < colliderBounds.size() && colliderBounds[j].box.min.x <= a.box.max.x; j++)
+		{
+			const ColliderBounds& b = colliderBounds[j];
+
+			if (!(a.mask & b.layer) && !(b.mask & a.layer)) continue;
+			if (a.box.max.y < b.box.min.y || b.box.max.y < a.box.min.y) continue;
+			if (TestColliders(a, b)) pairs.push_back({ a.entity, b.entity });
+		}
+	}
 }
@@ -17,6 +17,7 @@ static std::unordered_map<u64, GUITextField> textFieldPool;
 static std::unordered_map<u64, GUIFloatField> floatFieldPool;
 static std::unordered_map<u64, GUIRow> rowPool;
 static std::unordered_map<u64, GUIColumn> columnPool;
+static std::unordered_map<u64, GUIListView> listViewPool;
 
 static std::vector<u64> widgetStack;
 static u64 hotWidget;
@@ -39,9 +40,25 @@ static bool selectingText;
 static float textFieldInputTime;
 
 static bool dragging;
+static float guiScrollDelta;
 
 static bool initialized = false;
 
+//Hit testing grid, rebuilt each frame from the rects of built widgets that receive input
+#define GUI_HIT_CELL_SIZE 64
+
+struct GUIHitEntry
+{
+	vec2 min, max;
+	float renderDepth;
+	u64 id;
+};
+
+static std::vector<GUIHitEntry> hitEntries;
+static std::vector<std::vector<u32>> hitCells;
+static i32 hitCellsX;
+static i32 hitCellsY;
+
 void ProcessEnterKey();
 
 void GUIContext::Start()
@@ -74,12 +91,14 @@ void GUIContext::Start()
 		});
 		spriteSequence = &spriteSheet.sequences["ui"];
 
-		defaultFont = LoadFont("inter_semibald.ttf", 26);
+		defaultFont = LoadFontSDF("inter_semibald.ttf");
 
 		renderQueue.spriteShader = LoadShader("ui_vertcolor.vert", "sprite_vertcolor.frag");
 		renderQueue.spriteShader->EnableUniforms(SHADER_MAIN_TEX);
 		renderQueue.textShader = LoadShader("ui_vertcolor.vert", "text_vertcolor.frag");
 		renderQueue.textShader->EnableUniforms(SHADER_MAIN_TEX);
+		renderQueue.sdfTextShader = LoadShader("ui_vertcolor.vert", "text_sdf.frag");
+		renderQueue.sdfTextShader->EnableUniforms(SHADER_MAIN_TEX);
 		renderQueue.spriteSheet = &spriteSheet;
 		renderQueue.font = defaultFont;
 
@@ -124,6 +143,14 @@ void GUIContext::Start()
 
 		inputListener.BindAction(KEY_ENTER, PRESS, ProcessEnterKey);
 
+		inputListener.BindAction(MOUSE_SCROLL_UP, PRESS, []() {
+			guiScrollDelta -= 1.f;
+		});
+
+		inputListener.BindAction(MOUSE_SCROLL_DOWN, PRESS, []() {
+			guiScrollDelta += 1.f;
+		});
+
 		inputListener.priority = 1;
 
 		RegisterInputListener(&inputListener);
@@ -158,6 +185,7 @@ void GUIContext::Start()
 	defaultFloatField = GUIFloatField();
 	defaultRow = GUIRow();
 	defaultColumn = GUIColumn();
+	defaultListView = GUIListView();
 }
 
 void ProcessTextInput(u32 codepoint)
@@ -346,6 +374,75 @@ void NormalizeEdges(Edges& edges)
 	edges.left /= GetWindowSize().x / 2.f;
 }
 
+void ClearHitGrid()
+{
+	hitEntries.clear();
+
+	//Resize grid to cover the window, cells keep their capacity between frames
+	hitCellsX = std::max((i32)std::ceil(GetWindowSize().x / GUI_HIT_CELL_SIZE), 1);
+	hitCellsY = std::max((i32)std::ceil(GetWindowSize().y / GUI_HIT_CELL_SIZE), 1);
+	if (hitCells.size() != (size_t)hitCellsX * hitCellsY) hitCells.resize((size_t)hitCellsX * hitCellsY);
+	for (std::vector<u32>& cell : hitCells) cell.clear();
+}
+
+void InsertHitWidget(const GUIWidget* widget)
+{
+	GUIHitEntry entry;
+	entry.min = glm::max(widget->pos, widget->clipMin);
+	entry.max = glm::min(widget->pos + widget->size, widget->clipMax);
+	entry.renderDepth = widget->renderDepth;
+	entry.id = widget->id;
+
+	//Find covered cells, clipped to the window
+	i32 minX = std::max((i32)std::floor(entry.min.x / GUI_HIT_CELL_SIZE), 0);
+	i32 minY = std::max((i32)std::floor(entry.min.y / GUI_HIT_CELL_SIZE), 0);
+	i32 maxX = std::min((i32)std::floor(entry.max.x / GUI_HIT_CELL_SIZE), hitCellsX - 1);
+	i32 maxY = std::min((i32)std::floor(entry.max.y / GUI_HIT_CELL_SIZE), hitCellsY - 1);
+	if (minX > maxX || minY > maxY) return;
+
+	u32 entryIndex = (u32)hitEntries.size();
+	hitEntries.push_back(entry);
+
+	for (i32 y = minY; y <= maxY; y++)
+	{
+		for (i32 x = minX; x <= maxX; x++)
+		{
+			hitCells[x + y * hitCellsX].push_back(entryIndex);
+		}
+	}
+}
+
+//Returns the top-most widget under the given pixel position, or 0 if there is none
+u64 QueryHitGrid(vec2 position)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	i32 x = (i32)std::floor(position.x / GUI_HIT_CELL_SIZE);
+	i32 y = (i32)std::floor(position.y / GUI_HIT_CELL_SIZE);
+	if (x < 0 || y < 0 || x >= hitCellsX || y >= hitCellsY) return 0;
+
+	u64 hitID = 0;
+	float hitDepth = FLT_MAX;
+
+	for (u32 entryIndex : hitCells[x + y * hitCellsX])
+	{
+		const GUIHitEntry& entry = hitEntries[entryIndex];
+
+		//Lower render depth is drawn on top
+		if (entry.renderDepth < hitDepth
+			&& position.x > entry.min.x && position.x < entry.max.x
+			&& position.y > entry.min.y && position.y < entry.max.y)
+		{
+			hitID = entry.id;
+			hitDepth = entry.renderDepth;
+		}
+	}
+
+	return hitID;
+}
+
 void GUIContext::EndAndDraw()
 {
 #ifdef TRACY_ENABLE
@@ -356,36 +453,18 @@ void GUIContext::EndAndDraw()
 	bool foundHotWidget = false;
 	inputListener.onCharacterTyped = nullptr;
 
+	ClearHitGrid();
+
 	//Build
 	for (u64 id : buildWidgets)
 	{
 		GUIWidget* widget = &widgetPool[id];
 		if (widget->dirty) BuildWidget(widget->id);
-
-		//Calculate hot and active widgets
-		if (!foundHotWidget && widget->receiveInput)
-		{
-			//Calculate hit
-			if (mousePosition.x > widget->pos.x && mousePosition.x < widget->pos.x + widget->size.x
-				&& mousePosition.y > widget->pos.y && mousePosition.y < widget->pos.y + widget->size.y)
-			{
-				hotWidget = widget->id;
-				foundHotWidget = true;
-
-				if ((activeWidget == 0
-					|| widgetPool[activeWidget].componentType == GUI_TEXT_FIELD
-					|| widgetPool[activeWidget].componentType == GUI_FLOAT_FIELD)
-					&& guiMouseState == PRESS)
-				{
-					activeWidget = widget->id;
-
-					
-				}
-			}
-		}
+		if (widget->receiveInput) InsertHitWidget(widget);
+		if (widget->componentType == GUI_LIST_VIEW) listViewPool[id].viewHeight = widget->size.y;
 
 		//Do some extra processing
-		if (id != activeWidget && widgetPool[id].componentType == GUI_FLOAT_FIELD)
+		if (id != activeWidget && widget->componentType == GUI_FLOAT_FIELD)
 		{
 			//Set float field text to value
 			GUIFloatField* floatField = &floatFieldPool[id];
@@ -395,10 +474,45 @@ void GUIContext::EndAndDraw()
 		}
 	}
 
+	//Calculate hot and active widgets
+	u64 hitWidget = QueryHitGrid(mousePosition);
+	if (hitWidget != 0)
+	{
+		hotWidget = hitWidget;
+		foundHotWidget = true;
+
+		if ((activeWidget == 0
+			|| widgetPool[activeWidget].componentType == GUI_TEXT_FIELD
+			|| widgetPool[activeWidget].componentType == GUI_FLOAT_FIELD)
+			&& guiMouseState == PRESS)
+		{
+			activeWidget = hitWidget;
+		}
+	}
+
 	mouseOverGUI = foundHotWidget;
 
 	if (!foundHotWidget) hotWidget = 0;
 
+	//Scroll the list view under the mouse, walking up from the hot widget
+	if (guiScrollDelta != 0.f)
+	{
+		u64 scrollID = hotWidget;
+		while (scrollID != 0 && scrollID != canvasID && widgetPool[scrollID].componentType != GUI_LIST_VIEW)
+		{
+			scrollID = widgetPool[scrollID].parentID;
+		}
+
+		if (scrollID != 0 && widgetPool[scrollID].componentType == GUI_LIST_VIEW)
+		{
+			GUIListView* listView = &listViewPool[scrollID];
+			float maxScroll = std::max(listView->itemCount * listView->rowHeight - listView->viewHeight, 0.f);
+			listView->scroll = glm::clamp(listView->scroll + guiScrollDelta * listView->rowHeight * 3.f, 0.f, maxScroll);
+		}
+
+		guiScrollDelta = 0.f;
+	}
+
 	//Process hot and active input events
 	if (hotWidget != oldHotWidget)
 	{
@@ -588,13 +702,46 @@ void GUIContext::EndAndDraw()
 	//Draw
 	renderQueue.Clear();
 
-	for (u64 id : renderWidgets)
+	//List views clip their rows, nested clips are intersected with the outer one
+	struct ClipRegion
+	{
+		u32 renderEnd;
+		vec2 min, max;
+	};
+
+	std::vector<ClipRegion> clipStack;
+
+	for (u32 renderIndex = 0; renderIndex < renderWidgets.size(); renderIndex++)
 	{
+		while (!clipStack.empty() && renderIndex >= clipStack.back().renderEnd)
+		{
+			clipStack.pop_back();
+			if (clipStack.empty()) renderQueue.ClearScissor();
+			else renderQueue.SetScissor(clipStack.back().min, clipStack.back().max - clipStack.back().min);
+		}
+
+		u64 id = renderWidgets[renderIndex];
 		GUIWidget* widget = &widgetPool[id];
 		vec2 pos = widget->pos;
 		vec2 size = widget->size;
 
-		if (widget->componentType == GUI_IMAGE)
+		if (widget->componentType == GUI_LIST_VIEW)
+		{
+			ClipRegion clip;
+			clip.renderEnd = listViewPool[id].renderEnd;
+			clip.min = pos;
+			clip.max = pos + size;
+
+			if (!clipStack.empty())
+			{
+				clip.min = glm::max(clip.min, clipStack.back().min);
+				clip.max = glm::max(glm::min(clip.max, clipStack.back().max), clip.min);
+			}
+
+			clipStack.push_back(clip);
+			renderQueue.SetScissor(clip.min, clip.max - clip.min);
+		}
+		else if (widget->componentType == GUI_IMAGE)
 		{
 			GUIImage* image = &imagePool[id];
 			NormalizeRect(pos, size);
@@ -624,7 +771,7 @@ void GUIContext::EndAndDraw()
 			text.textSize = label->textHeightInPixels / GetWindowSize().y * 2.f;
 			text.color = label->color;
 			text.font = label->font;
-			renderQueue.PushText(text);
+			renderQueue.PushTextCached(text);
 		}
 		else if (widget->componentType == GUI_BUTTON)
 		{
@@ -720,7 +867,7 @@ void GUIContext::EndAndDraw()
 			text.textSize = slider->textHeightInPixels / GetWindowSize().y * 2.f;
 			text.color = _textColor;
 			text.font = slider->font;
-			renderQueue.PushText(text);
+			renderQueue.PushTextCached(text);
 		}
 		else if (widget->componentType == GUI_TEXT_FIELD)
 		{
@@ -758,7 +905,7 @@ void GUIContext::EndAndDraw()
 				text.textSize = textField->textHeightInPixels / GetWindowSize().y * 2.f;
 				text.color = vec4(textColor.x, textColor.y, textColor.z, 0.5);
 				text.font = textField->font;
-				renderQueue.PushText(text);
+				renderQueue.PushTextCached(text);
 			}
 
 			TextRenderInfo info;
@@ -776,7 +923,7 @@ void GUIContext::EndAndDraw()
 			text.textSize = textField->textHeightInPixels / GetWindowSize().y * 2.f;
 			text.color = textColor;
 			text.font = textField->font;
-			renderQueue.PushText(text, info);
+			renderQueue.PushTextCached(text, info);
 
 			textField->textInfo = info;
 
@@ -908,7 +1055,7 @@ void GUIContext::EndAndDraw()
 			text.textSize = floatField->textHeightInPixels / GetWindowSize().y * 2.f;
 			text.color = textColor;
 			text.font = floatField->font;
-			renderQueue.PushText(text, info);
+			renderQueue.PushTextCached(text, info);
 
 			floatField->textInfo = info;
 
@@ -1002,7 +1149,10 @@ void GUIContext::EndAndDraw()
 		}
 	}
 
+	if (!clipStack.empty()) renderQueue.ClearScissor();
+
 	renderQueue.Draw();
+	drawStats = renderQueue.drawStats;
 }
 
 void GUIContext::BuildWidget(u64 id)
@@ -1044,6 +1194,18 @@ void GUIContext::BuildWidget(u64 id)
 		widget->pivot.y = 1.f;
 		parentColumn->offset += widget->size.y + parentColumn->spacing;
 	}
+	else if (parent->componentType == GUI_LIST_VIEW)
+	{
+		//Rows stack downwards like a column, starting from the first visible row
+		GUIListView* parentList = &listViewPool[parent->id];
+		if (!widget->sizeYSet) widget->size.y = parentList->rowHeight;
+		parentPos.y += parentSize.y - widget->size.y - parentList->offset;
+		parentSize.y = widget->size.y;
+		widget->pos.y = 0.f;
+		widget->anchor.y = 1.f;
+		widget->pivot.y = 1.f;
+		parentList->offset += widget->size.y;
+	}
 
 	if (widget->marginLeftSet || widget->marginRightSet)
 	{
@@ -1063,6 +1225,16 @@ void GUIContext::BuildWidget(u64 id)
 	vec2 worldSpaceAnchor = parentPos + widget->anchor * parentSize;
 	widget->pos = worldSpaceAnchor + widget->pos - (widget->size * widget->pivot);
 
+	//Inherit clipping from parent, list views clip their children to their own rect
+	widget->clipMin = parent->clipMin;
+	widget->clipMax = parent->clipMax;
+
+	if (parent->componentType == GUI_LIST_VIEW)
+	{
+		widget->clipMin = glm::max(widget->clipMin, parent->pos);
+		widget->clipMax = glm::min(widget->clipMax, parent->pos + parent->size);
+	}
+
 	widget->renderDepth = guiDepth;
 	guiDepth -= 0.0001f;
 
@@ -1271,6 +1443,37 @@ void GUIContext::_Column(u64 id)
 	columnPool[id] = defaultColumn;
 }
 
+void GUIContext::_ListView(u64 id)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	GUIWidget widget;
+	widget.id = id;
+	widget.parentID = widgetStack.back();
+	widget.componentType = GUI_LIST_VIEW;
+	widget.receiveInput = true;
+
+	widgetStack.push_back(id);
+	widgetPool[id] = widget;
+
+	//Keep scroll state between frames
+	if (listViewPool.find(id) == listViewPool.end())
+	{
+		listViewPool[id] = defaultListView;
+	}
+
+	GUIListView* listView = &listViewPool[id];
+	listView->offset = -listView->scroll;
+	listView->firstVisible = 0;
+	listView->lastVisible = 0;
+	listView->renderBegin = (u32)renderWidgets.size();
+	listView->renderEnd = listView->renderBegin;
+
+	renderWidgets.push_back(id);
+}
+
 void GUIContext::pos(vec2 pos)
 {
 	widgetPool[widgetStack.back()].pos = pos;
@@ -1511,42 +1714,42 @@ void GUIContext::pressColor(vec4 color)
 	buttonPool[widget->id].pressColor = color;
 }
 
-void GUIContext::onHoverEnter(std::function<void(void)> onHoverEnter)
+void GUIContext::onHoverEnter(InputCallback onHoverEnter)
 {
 	GUIWidget* widget = &widgetPool[widgetStack.back()];
 	assert(widget->componentType == GUI_BUTTON);
 	buttonPool[widget->id].onHoverEnter = onHoverEnter;
 }
 
-void GUIContext::onHover(std::function<void(void)> onHover)
+void GUIContext::onHover(InputCallback onHover)
 {
 	GUIWidget* widget = &widgetPool[widgetStack.back()];
 	assert(widget->componentType == GUI_BUTTON);
 	buttonPool[widget->id].onHover = onHover;
 }
 
-void GUIContext::onHoverExit(std::function<void(void)> onHoverExit)
+void GUIContext::onHoverExit(InputCallback onHoverExit)
 {
 	GUIWidget* widget = &widgetPool[widgetStack.back()];
 	assert(widget->componentType == GUI_BUTTON);
 	buttonPool[widget->id].onHoverExit = onHoverExit;
 }
 
-void GUIContext::onPress(std::function<void(void)> onPress)
+void GUIContext::onPress(InputCallback onPress)
 {
 	GUIWidget* widget = &widgetPool[widgetStack.back()];
 	assert(widget->componentType == GUI_BUTTON);
 	buttonPool[widget->id].onPress = onPress;
 }
 
-void GUIContext::onHold(std::function<void(void)> onHold)
+void GUIContext::onHold(InputCallback onHold)
 {
 	GUIWidget* widget = &widgetPool[widgetStack.back()];
 	assert(widget->componentType == GUI_BUTTON);
 	buttonPool[widget->id].onHold = onHold;
 }
 
-void GUIContext::onRelease(std::function<void(void)> onRelease)
+void GUIContext::onRelease(InputCallback onRelease)
 {
 	GUIWidget* widget = &widgetPool[widgetStack.back()];
 	assert(widget->componentType == GUI_BUTTON);
@@ -1583,7 +1786,7 @@ void GUIContext::value(std::string* value)
 	textFieldPool[widget->id].value = value;
 }
 
-void GUIContext::onValueChanged(std::function<void(float)> onValueChanged)
+void GUIContext::onValueChanged(Delegate<void(float)> onValueChanged)
 {
 	GUIWidget* widget = &widgetPool[widgetStack.back()];
 	assert(widget->componentType == GUI_FLOAT_FIELD);
@@ -1638,6 +1841,49 @@ void GUIContext::spacing(float spacing)
 	}
 }
 
+void GUIContext::itemCount(u32 itemCount)
+{
+	GUIWidget* widget = &widgetPool[widgetStack.back()];
+	assert(widget->componentType == GUI_LIST_VIEW);
+	listViewPool[widget->id].itemCount = itemCount;
+}
+
+void GUIContext::rowHeight(float rowHeight)
+{
+	GUIWidget* widget = &widgetPool[widgetStack.back()];
+	assert(widget->componentType == GUI_LIST_VIEW);
+	listViewPool[widget->id].rowHeight = rowHeight;
+}
+
+void GUIContext::overscan(u32 overscan)
+{
+	GUIWidget* widget = &widgetPool[widgetStack.back()];
+	assert(widget->componentType == GUI_LIST_VIEW);
+	listViewPool[widget->id].overscan = overscan;
+}
+
+//Returns the range of rows [first, last) that should be emitted this frame. Uses the set height, or last frame's height
+//if the list is sized by its parent
+void GUIContext::visibleRange(u32& first, u32& last)
+{
+	GUIWidget* widget = &widgetPool[widgetStack.back()];
+	assert(widget->componentType == GUI_LIST_VIEW);
+	GUIListView* listView = &listViewPool[widget->id];
+
+	float viewHeight = widget->sizeYSet ? widget->size.y : listView->viewHeight;
+	float maxScroll = std::max(listView->itemCount * listView->rowHeight - viewHeight, 0.f);
+	listView->scroll = glm::clamp(listView->scroll, 0.f, maxScroll);
+
+	i32 firstRow = (i32)std::floor(listView->scroll / listView->rowHeight) - (i32)listView->overscan;
+	i32 lastRow = (i32)std::ceil((listView->scroll + viewHeight) / listView->rowHeight) + (i32)listView->overscan;
+	first = (u32)glm::clamp(firstRow, 0, (i32)listView->itemCount);
+	last = (u32)glm::clamp(lastRow, (i32)first, (i32)listView->itemCount);
+
+	listView->firstVisible = first;
+	listView->lastVisible = last;
+	listView->offset = first * listView->rowHeight - listView->scroll;
+}
+
 void GUIContext::EndNode()
 {
 #ifdef TRACY_ENABLE
@@ -1647,4 +1893,10 @@ void GUIContext::EndNode()
 	GUIWidget* widget = &widgetPool[widgetStack.back()];
 	buildWidgets.push_back(widget->id);
 	widgetStack.pop_back();
+
+	//Mark where list view children end, so they can be clipped
+	if (widget->componentType == GUI_LIST_VIEW)
+	{
+		listViewPool[widget->id].renderEnd = (u32)renderWidgets.size();
+	}
 }
@@ -1,6 +1,9 @@
 #include "bingus.h"
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <array>
 #include "glm/ext/matrix_projection.hpp"
 
 InputListener globalInputListener;
@@ -12,10 +15,144 @@ vec2 mousePrevPosition;
 vec3 mousePrevWorldPosition;
 
 static std::vector<InputListener*> listeners;
-static std::vector<InputEvent> eventBuffer;
 static std::vector<InputState> keyStates;
 static std::vector<u32> keyModifierStates;
 
+//Single producer, single consumer ring. GLFW only calls back on the main thread so both ends are there for now, but
+//the indices are atomic so the producer side can move to its own thread without changing the consumer
+struct InputEventRing
+{
+	InputEvent events[INPUT_EVENT_RING_SIZE];
+	std::atomic<u32> head = 0; //Next slot to write, only moved by the producer
+	std::atomic<u32> tail = 0; //Next slot to read, only moved by the consumer
+};
+
+static_assert((INPUT_EVENT_RING_SIZE & (INPUT_EVENT_RING_SIZE - 1)) == 0, "INPUT_EVENT_RING_SIZE must be a power of two");
+
+static InputEventRing eventRing;
+static u32 droppedInputEvents = 0;
+
+//Input recording
+#define INPUT_RECORDING_MAGIC	0x52494742 //"BGIR"
+#define INPUT_RECORDING_VERSION	2
+
+enum InputRecordType : u8 { RECORD_FRAME, RECORD_INPUT };
+
+struct InputRecordingHeader
+{
+	u32 magic;
+	u32 version;
+	u32 keyCount; //Followed by the state and modifiers of every key when recording started
+};
+
+//Events are stored without their timestamps, replays dispatch them at the same update they were recorded in
+struct RecordedInputEvent
+{
+	u16 key;
+	u8 state;
+	u8 modifier;
+};
+
+static std::ofstream recordingFile;
+static bool recording = false;
+static std::vector<u32> recordedCharacters; //Typed since the last input update
+static std::vector<u8> replayData;
+static size_t replayCursor = 0;
+static bool replaying = false;
+static bool exitWhenReplayFinished = false;
+
+static void PushInputEvent(InputEvent event, double time)
+{
+	//Real input is ignored while a replay drives things
+	if (replaying) return;
+
+	event.time = time;
+
+	u32 head = eventRing.head.load(std::memory_order_relaxed);
+	u32 tail = eventRing.tail.load(std::memory_order_acquire);
+
+	if (head - tail == INPUT_EVENT_RING_SIZE)
+	{
+		if (droppedInputEvents++ == 0) std::cout << "Input event ring full! : events are being dropped\n";
+		return;
+	}
+
+	eventRing.events[head & (INPUT_EVENT_RING_SIZE - 1)] = event;
+	eventRing.head.store(head + 1, std::memory_order_release);
+}
+
+//Takes the oldest event if it came in at or before time
+static bool PopInputEvent(InputEvent& event, double time)
+{
+	u32 tail = eventRing.tail.load(std::memory_order_relaxed);
+	if (tail == eventRing.head.load(std::memory_order_acquire)) return false;
+
+	const InputEvent& next = eventRing.events[tail & (INPUT_EVENT_RING_SIZE - 1)];
+	if (next.time > time) return false;
+
+	event = next;
+	eventRing.tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+//Only keys that changed, are held, or have something bound to UP are dispatched each frame
+static std::vector<InputListener*> keyListeners[KEY_LAST]; //Listeners with bindings for each key, in priority order
+static std::vector<u32> upBoundKeys;
+static bool keyListenersDirty = true;
+static std::vector<u32> heldKeys;
+static std::vector<u32> dispatchKeys;
+static std::vector<InputEvent> updateEvents;
+
+//GLFW key to bingus key, KEY_LAST for keys that aren't mapped
+struct GLFWKeyMapping
+{
+	i32 glfwKey;
+	u32 key;
+};
+
+static constexpr GLFWKeyMapping glfwKeyMappings[] = {
+	{ GLFW_KEY_APOSTROPHE, KEY_APOSTROPHE }, { GLFW_KEY_COMMA, KEY_COMMA }, { GLFW_KEY_MINUS, KEY_MINUS },
+	{ GLFW_KEY_PERIOD, KEY_PERIOD }, { GLFW_KEY_SLASH, KEY_SLASH }, { GLFW_KEY_BACKSLASH, KEY_BACKSLASH },
+	{ GLFW_KEY_EQUAL, KEY_EQUAL }, { GLFW_KEY_LEFT_BRACKET, KEY_LEFT_BRACKET }, { GLFW_KEY_RIGHT_BRACKET, KEY_RIGHT_BRACKET },
+	{ GLFW_KEY_GRAVE_ACCENT, KEY_GRAVE_ACCENT }, { GLFW_KEY_SEMICOLON, KEY_SEMICOLON },
+
+	{ GLFW_KEY_SPACE, KEY_SPACE }, { GLFW_KEY_ESCAPE, KEY_ESCAPE }, { GLFW_KEY_ENTER, KEY_ENTER }, { GLFW_KEY_TAB, KEY_TAB },
+	{ GLFW_KEY_BACKSPACE, KEY_BACKSPACE }, { GLFW_KEY_INSERT, KEY_INSERT }, { GLFW_KEY_DELETE, KEY_DELETE },
+	{ GLFW_KEY_UP, KEY_UP }, { GLFW_KEY_RIGHT, KEY_RIGHT }, { GLFW_KEY_DOWN, KEY_DOWN }, { GLFW_KEY_LEFT, KEY_LEFT },
+	{ GLFW_KEY_PAGE_UP, KEY_PAGE_UP }, { GLFW_KEY_PAGE_DOWN, KEY_PAGE_DOWN }, { GLFW_KEY_HOME, KEY_HOME }, { GLFW_KEY_END, KEY_END },
+	{ GLFW_KEY_CAPS_LOCK, KEY_CAPS_LOCK }, { GLFW_KEY_SCROLL_LOCK, KEY_SCROLL_LOCK }, { GLFW_KEY_NUM_LOCK, KEY_NUM_LOCK },
+	{ GLFW_KEY_PRINT_SCREEN, KEY_PRINT_SCREEN }, { GLFW_KEY_PAUSE, KEY_PAUSE },
+
+	{ GLFW_KEY_LEFT_CONTROL, KEY_CONTROL_LEFT }, { GLFW_KEY_LEFT_ALT, KEY_ALT_LEFT }, { GLFW_KEY_LEFT_SHIFT, KEY_SHIFT_LEFT },
+	{ GLFW_KEY_RIGHT_CONTROL, KEY_CONTROL_RIGHT }, { GLFW_KEY_RIGHT_ALT, KEY_ALT_RIGHT }, { GLFW_KEY_RIGHT_SHIFT, KEY_SHIFT_RIGHT },
+	{ GLFW_KEY_LEFT_SUPER, KEY_SUPER_LEFT }, { GLFW_KEY_RIGHT_SUPER, KEY_SUPER_RIGHT }, { GLFW_KEY_MENU, KEY_MENU },
+	{ GLFW_KEY_WORLD_1, KEY_WORLD_1 }, { GLFW_KEY_WORLD_2, KEY_WORLD_2 },
+
+	{ GLFW_KEY_KP_DECIMAL, KEY_KP_DECIMAL }, { GLFW_KEY_KP_DIVIDE, KEY_KP_DIVIDE }, { GLFW_KEY_KP_MULTIPLY, KEY_KP_MULTIPLY },
+	{ GLFW_KEY_KP_SUBTRACT, KEY_KP_SUBTRACT }, { GLFW_KEY_KP_ADD, KEY_KP_ADD }, { GLFW_KEY_KP_ENTER, KEY_KP_ENTER },
+	{ GLFW_KEY_KP_EQUAL, KEY_KP_EQUAL }
+};
+
+static constexpr std::array<u16, GLFW_KEY_LAST + 1> BuildGLFWKeyTable()
+{
+	std::array<u16, GLFW_KEY_LAST + 1> table = {};
+	for (u32 i = 0; i < table.size(); i++) table[i] = KEY_LAST;
+
+	//Runs that are contiguous on both sides
+	for (u32 i = 0; i < 26; i++) table[GLFW_KEY_A + i] = (u16)(KEY_A + i);
+	for (u32 i = 0; i < 10; i++) table[GLFW_KEY_0 + i] = (u16)(KEY_0 + i);
+	for (u32 i = 0; i < 10; i++) table[GLFW_KEY_KP_0 + i] = (u16)(KEY_KP_0 + i);
+	for (u32 i = 0; i < 25; i++) table[GLFW_KEY_F1 + i] = (u16)(KEY_F1 + i);
+
+	for (const GLFWKeyMapping& mapping : glfwKeyMappings) table[mapping.glfwKey] = (u16)mapping.key;
+	return table;
+}
+
+static constexpr std::array<u16, GLFW_KEY_LAST + 1> glfwKeyTable = BuildGLFWKeyTable();
+
+static_assert(glfwKeyTable[GLFW_KEY_Z] == KEY_Z && glfwKeyTable[GLFW_KEY_F25] == KEY_F25 && glfwKeyTable[GLFW_KEY_KP_9] == KEY_KP_9,
+	"GLFW key table is out of line with the key defines");
+
 void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
 	InputEvent event = { KEY_LAST, UP, KEY_MOD_NONE };
@@ -39,7 +176,7 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 		default: return;
 	}
 
-	eventBuffer.push_back(event);
+	PushInputEvent(event, glfwGetTime());
 }
 
 void MouseScrollCallback(GLFWwindow* window, double x, double y)
@@ -48,10 +185,10 @@ void MouseScrollCallback(GLFWwindow* window, double x, double y)
 
 	event.key = y > 0 ? MOUSE_SCROLL_UP : MOUSE_SCROLL_DOWN;
 	event.state = PRESS;
-	eventBuffer.push_back(event);
+	PushInputEvent(event, glfwGetTime());
 }
 
-void CharacterCallback(GLFWwindow* window, u32 codepoint)
+static void DispatchCharacter(u32 codepoint)
 {
 	for (auto itListener = listeners.begin(); itListener != listeners.end(); itListener++)
 	{
@@ -63,6 +200,14 @@ void CharacterCallback(GLFWwindow* window, u32 codepoint)
 	}
 }
 
+void CharacterCallback(GLFWwindow* window, u32 codepoint)
+{
+	if (replaying) return;
+	if (recording) recordedCharacters.push_back(codepoint);
+
+	DispatchCharacter(codepoint);
+}
+
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	InputEvent event = { KEY_LAST, UP, KEY_MOD_NONE };
@@ -129,105 +274,135 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 		default: return;
 	}
 
-	switch (key)
-	{
-		//TODO: Fill out rest of keyboard
-		case GLFW_KEY_A: event.key = KEY_A; break;
-		case GLFW_KEY_B: event.key = KEY_B; break;
-		case GLFW_KEY_C: event.key = KEY_C; break;
-		case GLFW_KEY_D: event.key = KEY_D; break;
-		case GLFW_KEY_E: event.key = KEY_E; break;
-		case GLFW_KEY_F: event.key = KEY_F; break;
-		case GLFW_KEY_G: event.key = KEY_G; break;
-		case GLFW_KEY_H: event.key = KEY_H; break;
-		case GLFW_KEY_I: event.key = KEY_I; break;
-		case GLFW_KEY_J: event.key = KEY_J; break;
-		case GLFW_KEY_K: event.key = KEY_K; break;
-		case GLFW_KEY_L: event.key = KEY_L; break;
-		case GLFW_KEY_M: event.key = KEY_M; break;
-		case GLFW_KEY_N: event.key = KEY_N; break;
-		case GLFW_KEY_O: event.key = KEY_O; break;
-		case GLFW_KEY_P: event.key = KEY_P; break;
-		case GLFW_KEY_Q: event.key = KEY_Q; break;
-		case GLFW_KEY_R: event.key = KEY_R; break;
-		case GLFW_KEY_S: event.key = KEY_S; break;
-		case GLFW_KEY_T: event.key = KEY_T; break;
-		case GLFW_KEY_U: event.key = KEY_U; break;
-		case GLFW_KEY_V: event.key = KEY_V; break;
-		case GLFW_KEY_W: event.key = KEY_W; break;
-		case GLFW_KEY_X: event.key = KEY_X; break;
-		case GLFW_KEY_Y: event.key = KEY_Y; break;
-		case GLFW_KEY_Z: event.key = KEY_Z; break;
-
-		case GLFW_KEY_0: event.key = KEY_0; break;
-		case GLFW_KEY_1: event.key = KEY_1; break;
-		case GLFW_KEY_2: event.key = KEY_2; break;
-		case GLFW_KEY_3: event.key = KEY_3; break;
-		case GLFW_KEY_4: event.key = KEY_4; break;
-		case GLFW_KEY_5: event.key = KEY_5; break;
-		case GLFW_KEY_6: event.key = KEY_6; break;
-		case GLFW_KEY_7: event.key = KEY_7; break;
-		case GLFW_KEY_8: event.key = KEY_8; break;
-		case GLFW_KEY_9: event.key = KEY_9; break;
-
-		case GLFW_KEY_APOSTROPHE: event.key = KEY_APOSTROPHE; break;
-		case GLFW_KEY_COMMA: event.key = KEY_COMMA; break;
-		case GLFW_KEY_MINUS: event.key = KEY_MINUS; break;
-		case GLFW_KEY_PERIOD: event.key = KEY_PERIOD; break;
-		case GLFW_KEY_SLASH: event.key = KEY_SLASH; break;
-		case GLFW_KEY_BACKSLASH: event.key = KEY_BACKSLASH; break;
-		case GLFW_KEY_EQUAL: event.key = KEY_EQUAL; break;
-		case GLFW_KEY_LEFT_BRACKET: event.key = KEY_LEFT_BRACKET; break;
-		case GLFW_KEY_RIGHT_BRACKET: event.key = KEY_RIGHT_BRACKET; break;
-		case GLFW_KEY_GRAVE_ACCENT: event.key = KEY_GRAVE_ACCENT; break;
-		case GLFW_KEY_SEMICOLON: event.key = KEY_SEMICOLON; break;
-
-		case GLFW_KEY_SPACE: event.key = KEY_SPACE; break;
-		case GLFW_KEY_ESCAPE: event.key = KEY_ESCAPE; break;
-		case GLFW_KEY_ENTER: event.key = KEY_ENTER; break;
-		case GLFW_KEY_TAB: event.key = KEY_TAB; break;
-		case GLFW_KEY_BACKSPACE: event.key = KEY_BACKSPACE; break;
-
-		case GLFW_KEY_INSERT: event.key = KEY_INSERT; break;
-		case GLFW_KEY_DELETE: event.key = KEY_DELETE; break;
-		case GLFW_KEY_UP: event.key = KEY_UP; break;
-		case GLFW_KEY_RIGHT: event.key = KEY_RIGHT; break;
-		case GLFW_KEY_DOWN: event.key = KEY_DOWN; break;
-		case GLFW_KEY_LEFT: event.key = KEY_LEFT; break;
-		case GLFW_KEY_PAGE_UP: event.key = KEY_PAGE_UP; break;
-		case GLFW_KEY_PAGE_DOWN: event.key = KEY_PAGE_DOWN; break;
-		case GLFW_KEY_HOME: event.key = KEY_HOME; break;
-		case GLFW_KEY_END: event.key = KEY_END; break;
-		case GLFW_KEY_CAPS_LOCK: event.key = KEY_CAPS_LOCK; break;
-		case GLFW_KEY_SCROLL_LOCK: event.key = KEY_SCROLL_LOCK; break;
-		case GLFW_KEY_NUM_LOCK: event.key = KEY_NUM_LOCK; break;
-		case GLFW_KEY_PRINT_SCREEN: event.key = KEY_PRINT_SCREEN; break;
-		case GLFW_KEY_PAUSE: event.key = KEY_PAUSE; break;
-
-		case GLFW_KEY_LEFT_CONTROL: event.key = KEY_CONTROL_LEFT; break;
-		case GLFW_KEY_LEFT_ALT: event.key = KEY_ALT_LEFT; break;
-		case GLFW_KEY_LEFT_SHIFT: event.key = KEY_SHIFT_LEFT; break;
-		case GLFW_KEY_RIGHT_CONTROL: event.key = KEY_CONTROL_RIGHT; break;
-		case GLFW_KEY_RIGHT_ALT: event.key = KEY_ALT_RIGHT; break;
-		case GLFW_KEY_RIGHT_SHIFT: event.key = KEY_SHIFT_RIGHT; break;
-		
-		case GLFW_KEY_F1: event.key = KEY_F1; break;
-		case GLFW_KEY_F2: event.key = KEY_F2; break;
-		case GLFW_KEY_F3: event.key = KEY_F3; break;
-		case GLFW_KEY_F4: event.key = KEY_F4; break;
-		case GLFW_KEY_F5: event.key = KEY_F5; break;
-		case GLFW_KEY_F6: event.key = KEY_F6; break;
-		case GLFW_KEY_F7: event.key = KEY_F7; break;
-		case GLFW_KEY_F8: event.key = KEY_F8; break;
-		case GLFW_KEY_F9: event.key = KEY_F9; break;
-		case GLFW_KEY_F10: event.key = KEY_F10; break;
-		case GLFW_KEY_F11: event.key = KEY_F11; break;
-		case GLFW_KEY_F12: event.key = KEY_F12; break;
+	if (key < 0 || key > GLFW_KEY_LAST) return;
 
-		default: return;
+	event.key = glfwKeyTable[key];
+	if (event.key == KEY_LAST) return;
+
+	PushInputEvent(event, glfwGetTime());
+}
+
+//Gamepad, polled every input update and turned into events only when a button or axis direction changes
+static i32 gamepadJoystick = -1;
+static bool gamepadScanNeeded = true;
+static bool gamepadConnected = false;
+static u8 gamepadButtons[GLFW_GAMEPAD_BUTTON_LAST + 1];
+static float gamepadAxes[GAMEPAD_AXIS_COUNT];
+static bool gamepadAxisKeys[GAMEPAD_RIGHT_TRIGGER - GAMEPAD_LEFT_STICK_LEFT + 1];
+
+void JoystickCallback(int joystick, int event)
+{
+	gamepadScanNeeded = true;
+}
+
+//Scales the stick so it starts from zero at the edge of the deadzone, the deadzone is round so diagonals aren't favoured
+static void FilterStick(float x, float y, float& outX, float& outY)
+{
+	float length = sqrtf(x * x + y * y);
+	if (length < GAMEPAD_STICK_DEADZONE)
+	{
+		outX = outY = 0.f;
+		return;
+	}
+
+	float scale = glm::min((length - GAMEPAD_STICK_DEADZONE) / (1.f - GAMEPAD_STICK_DEADZONE), 1.f) / length;
+	outX = x * scale;
+	outY = y * scale;
+}
+
+//GLFW triggers rest at -1
+static float FilterTrigger(float value)
+{
+	float pull = (value + 1.f) * 0.5f;
+	if (pull < GAMEPAD_TRIGGER_DEADZONE) return 0.f;
+	return glm::min((pull - GAMEPAD_TRIGGER_DEADZONE) / (1.f - GAMEPAD_TRIGGER_DEADZONE), 1.f);
+}
+
+static void SetGamepadKey(u32 key, bool pressed, bool& current, double time)
+{
+	if (pressed == current) return;
+
+	current = pressed;
+	InputEvent event = { key, pressed ? PRESS : RELEASE, KEY_MOD_NONE };
+	PushInputEvent(event, time);
+}
+
+static void SetGamepadState(const u8* buttons, const float* axes, double time)
+{
+	for (u32 button = 0; button <= GLFW_GAMEPAD_BUTTON_LAST; button++)
+	{
+		bool current = gamepadButtons[button] == GLFW_PRESS;
+		SetGamepadKey(GAMEPAD_A + button, buttons[button] == GLFW_PRESS, current, time);
+		gamepadButtons[button] = current ? GLFW_PRESS : GLFW_RELEASE;
 	}
 
-	eventBuffer.push_back(event);
+	memcpy(gamepadAxes, axes, sizeof(gamepadAxes));
+
+	//How far each axis key is pushed, in key order
+	float axisPush[] = {
+		-axes[GAMEPAD_AXIS_LEFT_X], axes[GAMEPAD_AXIS_LEFT_X],
+		axes[GAMEPAD_AXIS_LEFT_Y], -axes[GAMEPAD_AXIS_LEFT_Y],
+		-axes[GAMEPAD_AXIS_RIGHT_X], axes[GAMEPAD_AXIS_RIGHT_X],
+		axes[GAMEPAD_AXIS_RIGHT_Y], -axes[GAMEPAD_AXIS_RIGHT_Y],
+		axes[GAMEPAD_AXIS_LEFT_TRIGGER], axes[GAMEPAD_AXIS_RIGHT_TRIGGER]
+	};
+
+	//Held keys let go at a lower threshold, so an axis resting on the press threshold doesn't flicker
+	for (u32 i = 0; i < sizeof(axisPush) / sizeof(axisPush[0]); i++)
+	{
+		float threshold = gamepadAxisKeys[i] ? GAMEPAD_AXIS_RELEASE_THRESHOLD : GAMEPAD_AXIS_PRESS_THRESHOLD;
+		SetGamepadKey(GAMEPAD_LEFT_STICK_LEFT + i, axisPush[i] > threshold, gamepadAxisKeys[i], time);
+	}
+}
+
+static void PollGamepad(double time)
+{
+	//Only look for a gamepad when one has been plugged in or taken out
+	if (gamepadScanNeeded)
+	{
+		gamepadScanNeeded = false;
+		gamepadJoystick = -1;
+
+		for (i32 joystick = GLFW_JOYSTICK_1; joystick <= GLFW_JOYSTICK_LAST; joystick++)
+		{
+			if (glfwJoystickIsGamepad(joystick))
+			{
+				gamepadJoystick = joystick;
+				break;
+			}
+		}
+	}
+
+	GLFWgamepadstate state;
+	gamepadConnected = gamepadJoystick != -1 && glfwGetGamepadState(gamepadJoystick, &state);
+
+	if (!gamepadConnected)
+	{
+		//Let go of everything so nothing sticks down
+		u8 released[GLFW_GAMEPAD_BUTTON_LAST + 1] = {};
+		float centered[GAMEPAD_AXIS_COUNT] = {};
+		SetGamepadState(released, centered, time);
+		return;
+	}
+
+	float axes[GAMEPAD_AXIS_COUNT];
+	FilterStick(state.axes[GLFW_GAMEPAD_AXIS_LEFT_X], -state.axes[GLFW_GAMEPAD_AXIS_LEFT_Y], axes[GAMEPAD_AXIS_LEFT_X], axes[GAMEPAD_AXIS_LEFT_Y]);
+	FilterStick(state.axes[GLFW_GAMEPAD_AXIS_RIGHT_X], -state.axes[GLFW_GAMEPAD_AXIS_RIGHT_Y], axes[GAMEPAD_AXIS_RIGHT_X], axes[GAMEPAD_AXIS_RIGHT_Y]);
+	axes[GAMEPAD_AXIS_LEFT_TRIGGER] = FilterTrigger(state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER]);
+	axes[GAMEPAD_AXIS_RIGHT_TRIGGER] = FilterTrigger(state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER]);
+
+	SetGamepadState(state.buttons, axes, time);
+}
+
+float GetGamepadAxis(u32 axis)
+{
+	assert(axis < GAMEPAD_AXIS_COUNT);
+	return gamepadAxes[axis];
+}
+
+bool IsGamepadConnected()
+{
+	return gamepadConnected;
 }
 
 void InitializeInput(GLFWwindow* window)
@@ -240,6 +415,7 @@ void InitializeInput(GLFWwindow* window)
 	glfwSetMouseButtonCallback(window, MouseButtonCallback);
 	glfwSetKeyCallback(window, KeyCallback);
 	glfwSetCharCallback(window, CharacterCallback);
+	glfwSetJoystickCallback(JoystickCallback);
 
 	//Initialize key states
 	keyStates = std::vector<InputState>(KEY_LAST, UP);
@@ -260,6 +436,7 @@ void SortListeners()
 {
 	//Sort input list
 	sort(listeners.begin(), listeners.end(), CompareInputListeners);
+	keyListenersDirty = true;
 }
 
 void RegisterInputListener(InputListener* listener)
@@ -289,23 +466,35 @@ std::string GetInputBindingName(u32 binding)
 		"End", "Caps Lock", "Scroll Lock", "Num Lock", "Print Screen", "Pause",
 		"Left Control", "Left Alt", "Left Shift", "Right Control", "Right Alt", "Right Shift",
 		"F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12",
+		"F13", "F14", "F15", "F16", "F17", "F18", "F19", "F20", "F21", "F22", "F23", "F24", "F25",
+		"Keypad 0", "Keypad 1", "Keypad 2", "Keypad 3", "Keypad 4", "Keypad 5", "Keypad 6", "Keypad 7", "Keypad 8", "Keypad 9",
+		"Keypad .", "Keypad /", "Keypad *", "Keypad -", "Keypad +", "Keypad Enter", "Keypad =",
+		"Left Super", "Right Super", "Menu", "World 1", "World 2",
+		"Gamepad A", "Gamepad B", "Gamepad X", "Gamepad Y", "Left Bumper", "Right Bumper", "Back", "Start", "Guide",
+		"Left Thumb", "Right Thumb", "D-Pad Up", "D-Pad Right", "D-Pad Down", "D-Pad Left",
+		"Left Stick Left", "Left Stick Right", "Left Stick Up", "Left Stick Down",
+		"Right Stick Left", "Right Stick Right", "Right Stick Up", "Right Stick Down", "Left Trigger", "Right Trigger",
 		"KEY_LAST"
 	};
 
 	return inputBindingNames[binding];
 }
 
-void CalculateWorldMousePos(GLFWwindow* window)
+vec2 GetCursorPixelPosition(GLFWwindow* window)
+{
+	double x, y;
+	glfwGetCursorPos(window, &x, &y);
+	return vec2(x, GetWindowSize().y - y);
+}
+
+void CalculateWorldMousePos(vec2 cursorPosition)
 {
 #ifdef TRACY_ENABLE
 	ZoneScoped;
 #endif
 	//Step mouse position
-	double x, y;
-	glfwGetCursorPos(window, &x, &y);
-
 	mousePrevPosition = mousePosition;
-	mousePosition = vec2(x, GetWindowSize().y - y);
+	mousePosition = cursorPosition;
 	mouseDelta = mousePosition - mousePrevPosition;
 
 	mousePrevWorldPosition = PixelToWorld(vec3(mousePrevPosition.x, mousePrevPosition.y, 0));
@@ -340,28 +529,59 @@ void InputListener::BindAction(u32 key, InputState state, u32 modifier, std::str
 	BindAction(key, state, modifier, false, namedEvent);
 }
 
+static InputBinding* FindKeyBinding(InputListener* listener, u32 key, InputState state, u32 modifier)
+{
+	for (InputKeyBinding& keyBinding : listener->keyBindings[key])
+	{
+		if (keyBinding.state == state && keyBinding.modifier == modifier) return &keyBinding.binding;
+	}
+
+	return nullptr;
+}
+
+static void SetKeyBinding(InputListener* listener, u32 key, InputState state, u32 modifier, const InputBinding& binding)
+{
+	InputBinding* existing = FindKeyBinding(listener, key, state, modifier);
+	if (existing != nullptr) *existing = binding;
+	else listener->keyBindings[key].push_back({ state, modifier, binding });
+
+	keyListenersDirty = true;
+}
+
 void InputListener::BindAction(u32 key, InputState state, u32 modifier, bool blocking, InputCallback callback)
 {
-	InputEvent event = { key, state, modifier };
-	InputBinding binding = { callback, "", blocking};
-	bindings[event] = binding;
+	SetKeyBinding(this, key, state, modifier, { std::move(callback), NAMED_EVENT_NONE, blocking });
 }
 
 void InputListener::BindAction(u32 key, InputState state, u32 modifier, bool blocking, std::string namedEvent)
 {
-	InputEvent event = { key, state, modifier };
-	InputBinding binding = { nullptr, namedEvent, blocking };
-	bindings[event] = binding;
+	SetKeyBinding(this, key, state, modifier, { nullptr, GetNamedEventID(namedEvent), blocking });
+}
+
+//Shared by every listener so the same name always means the same id, id 0 is reserved for no event
+static std::unordered_map<std::string, u32> namedEventIDs;
+
+u32 GetNamedEventID(const std::string& name)
+{
+	auto it = namedEventIDs.find(name);
+	if (it != namedEventIDs.end()) return it->second;
+
+	u32 id = (u32)namedEventIDs.size() + 1;
+	namedEventIDs.emplace(name, id);
+	return id;
 }
 
 void InputListener::BindNamedEvent(std::string name, InputCallback callback)
 {
-	namedEvents[name] = callback;
+	u32 id = GetNamedEventID(name);
+	if (id >= namedEvents.size()) namedEvents.resize(id + 1);
+	namedEvents[id] = std::move(callback);
 }
 
 void InputListener::UnbindNamedEvent(std::string name)
 {
-	namedEvents.erase(name);
+	u32 id = GetNamedEventID(name);
+	if (id < namedEvents.size()) namedEvents[id] = nullptr;
 }
 
 void InputListener::UnbindAction(u32 key, InputState state)
@@ -371,7 +591,12 @@ void InputListener::UnbindAction(u32 key, InputState state)
 
 void InputListener::UnbindAction(u32 key, InputState state, u32 modifier)
 {
-	bindings.erase({ key, state, KEY_MOD_ANY });
+	std::vector<InputKeyBinding>& bindings = keyBindings[key];
+	bindings.erase(std::remove_if(bindings.begin(), bindings.end(), [&](const InputKeyBinding& keyBinding) {
+		return keyBinding.state == state && keyBinding.modifier == modifier;
+	}), bindings.end());
+
+	keyListenersDirty = true;
 }
 
 void InputListener::SetPriority(i32 priority)
@@ -380,72 +605,326 @@ void InputListener::SetPriority(i32 priority)
 	SortListeners();
 }
 
-void UpdateInput(GLFWwindow* window, float dt)
+static void RebuildKeyListeners()
 {
 #ifdef TRACY_ENABLE
 	ZoneScoped;
 #endif
 
-	CalculateWorldMousePos(window);
+	upBoundKeys.clear();
 
-	//Process events in buffer
-	for (auto itEvent = eventBuffer.begin(); itEvent != eventBuffer.end(); itEvent++)
+	for (u32 key = 0; key != KEY_LAST; key++)
 	{
+		keyListeners[key].clear();
+		bool upBound = false;
 
+		for (InputListener* listener : listeners)
+		{
+			if (listener->keyBindings[key].empty()) continue;
 
-		keyStates[itEvent->key] = itEvent->state;
-		keyModifierStates[itEvent->key] = itEvent->modifier;
+			keyListeners[key].push_back(listener);
+			for (const InputKeyBinding& keyBinding : listener->keyBindings[key])
+			{
+				if (keyBinding.state == UP) upBound = true;
+			}
+		}
+
+		if (upBound) upBoundKeys.push_back(key);
 	}
 
-	//Clear that buffer - it is a good idea to remember to do this
-	eventBuffer.clear();
+	keyListenersDirty = false;
+}
+
+//Triggers the binding's callback, or named event if null. Returns true if it blocks the listeners after it
+static bool TriggerBinding(InputListener* listener, const InputBinding& binding)
+{
+	//The callback is free to bind more, which can grow the vectors the binding and named events live in. So everything
+	//is copied out before it runs rather than called through a reference that could be left dangling
+	bool blocks = binding.blocking || listener->blocking;
+	InputCallback callback = binding.callback;
 
+	if (callback == nullptr)
+	{
+		//Named events bound to a key but not yet given a callback do nothing
+		if (binding.eventID >= listener->namedEvents.size()) return blocks;
+		callback = listener->namedEvents[binding.eventID];
+	}
+
+	if (callback != nullptr) callback();
+	return blocks;
+}
+
+static void DispatchKey(u32 key)
+{
+	InputState state = keyStates[key];
+
+	for (InputListener* listener : keyListeners[key])
+	{
+		//Check for event with matching modifier, then with 'any' modifier
+		InputBinding* binding = FindKeyBinding(listener, key, state, keyModifierStates[key]);
+		if (binding != nullptr && TriggerBinding(listener, *binding)) break;
+
+		binding = FindKeyBinding(listener, key, state, KEY_MOD_ANY);
+		if (binding != nullptr && TriggerBinding(listener, *binding)) break;
+	}
+}
+
+static void WriteRecording(const void* data, size_t size)
+{
+	recordingFile.write((const char*)data, size);
+}
+
+static bool ReadReplay(void* data, size_t size)
+{
+	if (replayCursor + size > replayData.size()) return false;
+
+	memcpy(data, replayData.data() + replayCursor, size);
+	replayCursor += size;
+	return true;
+}
+
+bool StartInputRecording(std::string filePath)
+{
+	StopInputRecording();
+	if (replaying) return false;
+
+	recordingFile.open(filePath, std::ios::binary);
+	if (recordingFile.fail())
+	{
+		std::cout << "Failed to start input recording! : couldn't open " << filePath << "\n";
+		return false;
+	}
+
+	InputRecordingHeader header = { INPUT_RECORDING_MAGIC, INPUT_RECORDING_VERSION, KEY_LAST };
+	WriteRecording(&header, sizeof(header));
+
+	//Keys already held when recording starts have to be held when the replay starts too
 	for (u32 key = 0; key != KEY_LAST; key++)
 	{
-		//Send event to listeners
-		for (auto itListener = listeners.begin(); itListener != listeners.end(); itListener++)
-		{
-			//Check for event with matching modifier
-			InputEvent event = { key, keyStates[key], keyModifierStates[key] };
-			auto entry = (*itListener)->bindings.find(event);
+		u8 state[2] = { (u8)keyStates[key], (u8)keyModifierStates[key] };
+		WriteRecording(state, sizeof(state));
+	}
 
-			if (entry != (*itListener)->bindings.end())
-			{
-				//Binding for this event exists, trigger callback, or named event if null
-				if (entry->second.callback == nullptr)
-				{
-					(*itListener)->namedEvents[entry->second.eventName]();
-				}
-				else
-				{
-					entry->second.callback();
-				}
-
-				//Block if either listener or binding is set to blocking
-				if (entry->second.blocking || (*itListener)->blocking) break;
-			}
+	recordedCharacters.clear();
+	recording = true;
+	std::cout << "Input recording started : @" << filePath << "\n";
+	return true;
+}
 
-			//Check for event with 'any' modifier
-			InputEvent anyModEvent = { key, keyStates[key], KEY_MOD_ANY };
-			auto anyModEntry = (*itListener)->bindings.find(anyModEvent);
+void StopInputRecording()
+{
+	if (!recording) return;
 
-			if (anyModEntry != (*itListener)->bindings.end())
-			{
-				//Binding for this event exists, trigger callback, or named event if null
-				if (anyModEntry->second.callback == nullptr)
-				{
-					(*itListener)->namedEvents[anyModEntry->second.eventName]();
-				}
-				else
-				{
-					anyModEntry->second.callback();
-				}
-
-				//Block if either listener or binding is set to blocking
-				if (anyModEntry->second.blocking || (*itListener)->blocking) break;
-			}
+	recordingFile.close();
+	recording = false;
+	std::cout << "Input recording stopped\n";
+}
+
+static void FinishInputReplay()
+{
+	replaying = false;
+	replayData.clear();
+	std::cout << "Input replay finished\n";
+
+	if (exitWhenReplayFinished) ExitGame();
+}
+
+bool StartInputReplay(std::string filePath, bool exitWhenFinished)
+{
+	StopInputRecording();
+
+	std::ifstream file(filePath, std::ios::binary);
+	if (file.fail())
+	{
+		std::cout << "Failed to start input replay! : file not found: " << filePath << "\n";
+		return false;
+	}
+
+	replayData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	replayCursor = 0;
+
+	InputRecordingHeader header;
+	if (!ReadReplay(&header, sizeof(header)) || header.magic != INPUT_RECORDING_MAGIC
+		|| header.version != INPUT_RECORDING_VERSION || header.keyCount != KEY_LAST)
+	{
+		std::cout << "Failed to start input replay! : not a recording from this version @" << filePath << "\n";
+		replayData.clear();
+		return false;
+	}
+
+	heldKeys.clear();
+	for (u32 key = 0; key != KEY_LAST; key++)
+	{
+		u8 state[2];
+		if (!ReadReplay(state, sizeof(state))) return false;
+
+		keyStates[key] = (InputState)state[0];
+		keyModifierStates[key] = state[1];
+		if (keyStates[key] == HOLD) heldKeys.push_back(key);
+	}
+
+	//Drop whatever real input is still waiting
+	InputEvent event;
+	while (PopInputEvent(event, glfwGetTime())) { }
+
+	exitWhenReplayFinished = exitWhenFinished;
+	replaying = true;
+	std::cout << "Input replay started : @" << filePath << "\n";
+	return true;
+}
+
+bool IsRecordingInput()
+{
+	return recording;
+}
+
+bool IsReplayingInput()
+{
+	return replaying;
+}
+
+float RecordFrameTime(float dt)
+{
+	if (recording)
+	{
+		u8 type = RECORD_FRAME;
+		WriteRecording(&type, sizeof(type));
+		WriteRecording(&dt, sizeof(dt));
+	}
+	else if (replaying)
+	{
+		u8 type;
+		float recordedDt;
+		if (!ReadReplay(&type, sizeof(type)) || type != RECORD_FRAME || !ReadReplay(&recordedDt, sizeof(recordedDt)))
+		{
+			FinishInputReplay();
+			return dt;
 		}
 
+		return recordedDt;
+	}
+
+	return dt;
+}
+
+//Reads the next input update from the replay, applying its events and typed characters. False once the log runs out
+static bool ReplayInputUpdate(vec2& cursorPosition)
+{
+	u8 type;
+	u16 eventCount, characterCount;
+	if (!ReadReplay(&type, sizeof(type)) || type != RECORD_INPUT || !ReadReplay(&cursorPosition, sizeof(cursorPosition))
+		|| !ReadReplay(&eventCount, sizeof(eventCount)) || !ReadReplay(&characterCount, sizeof(characterCount)))
+	{
+		return false;
+	}
+
+	//Characters were dispatched by GLFW before the update they were logged with
+	for (u16 i = 0; i < characterCount; i++)
+	{
+		u32 codepoint;
+		if (!ReadReplay(&codepoint, sizeof(codepoint))) return false;
+		DispatchCharacter(codepoint);
+	}
+
+	u8 hasGamepad;
+	if (!ReadReplay(&hasGamepad, sizeof(hasGamepad))) return false;
+
+	gamepadConnected = hasGamepad;
+	if (!hasGamepad) memset(gamepadAxes, 0, sizeof(gamepadAxes));
+	else if (!ReadReplay(gamepadAxes, sizeof(gamepadAxes))) return false;
+
+	for (u16 i = 0; i < eventCount; i++)
+	{
+		RecordedInputEvent recorded;
+		if (!ReadReplay(&recorded, sizeof(recorded)) || recorded.key >= KEY_LAST) return false;
+
+		InputEvent event = { recorded.key, (InputState)recorded.state, recorded.modifier };
+		updateEvents.push_back(event);
+	}
+
+	return true;
+}
+
+static void RecordInputUpdate(vec2 cursorPosition)
+{
+	u8 type = RECORD_INPUT;
+	u16 eventCount = (u16)updateEvents.size();
+	u16 characterCount = (u16)recordedCharacters.size();
+
+	WriteRecording(&type, sizeof(type));
+	WriteRecording(&cursorPosition, sizeof(cursorPosition));
+	WriteRecording(&eventCount, sizeof(eventCount));
+	WriteRecording(&characterCount, sizeof(characterCount));
+	WriteRecording(recordedCharacters.data(), recordedCharacters.size() * sizeof(u32));
+
+	//Analog axes only while there is a gamepad to read them from
+	u8 hasGamepad = gamepadConnected;
+	WriteRecording(&hasGamepad, sizeof(hasGamepad));
+	if (hasGamepad) WriteRecording(gamepadAxes, sizeof(gamepadAxes));
+
+	for (const InputEvent& event : updateEvents)
+	{
+		RecordedInputEvent recorded = { (u16)event.key, (u8)event.state, (u8)event.modifier };
+		WriteRecording(&recorded, sizeof(recorded));
+	}
+
+	recordedCharacters.clear();
+}
+
+void UpdateInput(GLFWwindow* window, float dt)
+{
+	UpdateInputUntil(window, glfwGetTime());
+}
+
+void UpdateInputUntil(GLFWwindow* window, double time)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	if (keyListenersDirty) RebuildKeyListeners();
+
+	//Gather this update's events, from the replay or from the ring
+	updateEvents.clear();
+	vec2 cursorPosition;
+	if (replaying && !ReplayInputUpdate(cursorPosition)) FinishInputReplay();
+
+	if (!replaying)
+	{
+		cursorPosition = GetCursorPixelPosition(window);
+		PollGamepad(time);
+
+		InputEvent event;
+		while (PopInputEvent(event, time)) updateEvents.push_back(event);
+
+		if (recording) RecordInputUpdate(cursorPosition);
+	}
+
+	CalculateWorldMousePos(cursorPosition);
+
+	//Process events, the last event for a key wins
+	dispatchKeys.clear();
+	for (const InputEvent& event : updateEvents)
+	{
+		keyStates[event.key] = event.state;
+		keyModifierStates[event.key] = event.modifier;
+		dispatchKeys.push_back(event.key);
+	}
+
+	dispatchKeys.insert(dispatchKeys.end(), heldKeys.begin(), heldKeys.end());
+	for (u32 key : upBoundKeys)
+	{
+		if (keyStates[key] == UP) dispatchKeys.push_back(key);
+	}
+
+	//Keys are dispatched in key order
+	std::sort(dispatchKeys.begin(), dispatchKeys.end());
+	dispatchKeys.erase(std::unique(dispatchKeys.begin(), dispatchKeys.end()), dispatchKeys.end());
+
+	for (u32 key : dispatchKeys)
+	{
+		DispatchKey(key);
+
 		//Update event
 		if (keyStates[key] == PRESS)
 		{
@@ -460,4 +939,11 @@ void UpdateInput(GLFWwindow* window, float dt)
 	//Reset scroll state, as it should only be in either PRESS or UP state
 	keyStates[MOUSE_SCROLL_UP] = UP;
 	keyStates[MOUSE_SCROLL_DOWN] = UP;
+
+	//Every held key was dispatched, so the held set is whatever is still in HOLD
+	heldKeys.clear();
+	for (u32 key : dispatchKeys)
+	{
+		if (keyStates[key] == HOLD) heldKeys.push_back(key);
+	}
 }
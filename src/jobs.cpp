@@ -0,0 +1,145 @@
+#include "bingus.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+//One ParallelFor runs at a time. Workers sleep until the generation moves on, then pull batches off a shared counter
+//alongside the calling thread
+struct JobPool
+{
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool quit = false;
+	u64 generation = 0;
+
+	//Current ParallelFor, function is null between them so a worker waking late can't join a finished one
+	const JobRangeFunction* function = nullptr;
+	u32 count = 0;
+	u32 batchSize = 0;
+	u32 batchCount = 0;
+	std::atomic<u32> nextBatch{ 0 };
+	std::atomic<u32> batchesDone{ 0 };
+	std::atomic<u32> activeWorkers{ 0 };
+
+	~JobPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+
+		wake.notify_all();
+		for (std::thread& thread : threads) thread.join();
+	}
+};
+
+static JobPool jobPool;
+static thread_local bool insideJob = false;
+
+static void RunJobBatches(const JobRangeFunction& function, u32 count, u32 batchSize, u32 batchCount)
+{
+	while (true)
+	{
+		u32 batch = jobPool.nextBatch.fetch_add(1, std::memory_order_relaxed);
+		if (batch >= batchCount) return;
+
+		u32 begin = batch * batchSize;
+		function(begin, std::min(begin + batchSize, count));
+		jobPool.batchesDone.fetch_add(1, std::memory_order_release);
+	}
+}
+
+static void JobWorkerThread()
+{
+	insideJob = true;
+	u64 seenGeneration = 0;
+
+	while (true)
+	{
+		const JobRangeFunction* function;
+		u32 count, batchSize, batchCount;
+
+		{
+			std::unique_lock<std::mutex> lock(jobPool.mutex);
+			jobPool.wake.wait(lock, [&]() { return jobPool.quit || jobPool.generation != seenGeneration; });
+			if (jobPool.quit) return;
+
+			seenGeneration = jobPool.generation;
+			if (jobPool.function == nullptr) continue;
+
+			function = jobPool.function;
+			count = jobPool.count;
+			batchSize = jobPool.batchSize;
+			batchCount = jobPool.batchCount;
+			jobPool.activeWorkers++;
+		}
+
+		RunJobBatches(*function, count, batchSize, batchCount);
+		jobPool.activeWorkers--;
+	}
+}
+
+u32 GetJobThreadCount()
+{
+	//Leaves a core for the main thread, which works on batches too
+	u32 hardwareThreads = std::thread::hardware_concurrency();
+	return std::clamp(hardwareThreads > 1 ? hardwareThreads - 1 : 1u, 1u, (u32)JOB_POOL_MAX_THREADS);
+}
+
+void ParallelFor(u32 count, u32 batchSize, JobRangeFunction function)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	if (count == 0) return;
+	batchSize = std::max(batchSize, 1u);
+
+	//Not worth waking anyone for a single batch, and jobs can't start jobs of their own
+	if (count <= batchSize || insideJob)
+	{
+		function(0, count);
+		return;
+	}
+
+	if (jobPool.threads.empty())
+	{
+		for (u32 i = 0; i < GetJobThreadCount(); i++)
+		{
+			jobPool.threads.push_back(std::thread(JobWorkerThread));
+		}
+	}
+
+	u32 batchCount = (count + batchSize - 1) / batchSize;
+
+	{
+		std::lock_guard<std::mutex> lock(jobPool.mutex);
+		jobPool.function = &function;
+		jobPool.count = count;
+		jobPool.batchSize = batchSize;
+		jobPool.batchCount = batchCount;
+		jobPool.nextBatch = 0;
+		jobPool.batchesDone = 0;
+		jobPool.generation++;
+	}
+
+	jobPool.wake.notify_all();
+
+	insideJob = true;
+	RunJobBatches(function, count, batchSize, batchCount);
+	insideJob = false;
+
+	while (jobPool.batchesDone.load(std::memory_order_acquire) != batchCount) std::this_thread::yield();
+
+	{
+		std::lock_guard<std::mutex> lock(jobPool.mutex);
+		jobPool.function = nullptr;
+	}
+
+	//Workers that picked this one up may still be finding the counter empty, they hold a pointer to function
+	while (jobPool.activeWorkers.load() != 0) std::this_thread::yield();
+}
@@ -24,23 +24,22 @@ void InitializeRenderer()
 {
 	//Render settings
 	//TODO: Make these externally accessible, perhaps when adding a platform independence layer
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDepthFunc(GL_LEQUAL);
-	glEnable(GL_DEPTH_TEST);
-	glfwSwapInterval(0);
+	ResetGLStateCache();
+	SetCapability(GL_BLEND, true);
+	SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	SetDepthFunc(GL_LEQUAL);
+	SetCapability(GL_DEPTH_TEST, true);
 
 	//Initialize camera
 	glGenBuffers(1, &cameraUBO);
-	glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+	BindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
 	glBindBufferBase(GL_UNIFORM_BUFFER, 0, cameraUBO);
 	glBufferData(GL_UNIFORM_BUFFER, sizeof(mat4) * 2, NULL, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	SetCameraPosition(vec2(0));
 	SetCameraSize(2);
 
 	//Load engine fonts
-	LoadFont("arial.ttf", 80);
+	SetPlaceholderFont(LoadFont("arial.ttf", 80));
 	LoadFont("linux_libertine.ttf", 80);
 
 	//TODO: Load other enegine resources as above?
@@ -51,6 +50,8 @@ void InitializeRenderer()
 	globalRenderQueue.spriteShader->EnableUniforms(SHADER_MAIN_TEX);
 	globalRenderQueue.textShader = LoadShader("world_vertcolor.vert", "text_vertcolor.frag");
 	globalRenderQueue.textShader->EnableUniforms(SHADER_MAIN_TEX);
+	globalRenderQueue.sdfTextShader = LoadShader("world_vertcolor.vert", "text_sdf.frag");
+	globalRenderQueue.sdfTextShader->EnableUniforms(SHADER_MAIN_TEX);
 	globalRenderQueue.spriteSheet = nullptr; //TODO: Change this?
 	globalRenderQueue.font = LoadFont("arial.ttf", 80);
 }
@@ -62,17 +63,242 @@ void InitializeRenderer()
 // d8'   .8P 88    88 88.  .88 88.  .88 88.  ... 88       
 //  Y88888P  dP    dP `88888P8 `88888P8 `88888P' dP       
 
-u32 activeShaderID;
-
 void SetActiveShader(Shader* shader)
 {
 	assert(shader != nullptr);
+	UseProgram(shader->id);
+}
+
+//GL state cache, mirrors what is bound so repeated binds never reach the driver
+#define GL_STATE_UNKNOWN 0xFFFFFFFF
+
+enum GLCapabilityBit
+{
+	CAPABILITY_BLEND = 0x01,
+	CAPABILITY_DEPTH_TEST = 0x02,
+	CAPABILITY_SCISSOR_TEST = 0x04,
+	CAPABILITY_LINE_SMOOTH = 0x08
+};
+
+struct GLStateCache
+{
+	u32 program;
+	u32 vertexArray;
+	u32 arrayBuffer;
+	u32 elementBuffer; //Part of the vertex array's state, unknown after switching vertex arrays
+	u32 uniformBuffer;
+	u32 activeUnit;
+	u32 textures[GL_STATE_TEXTURE_UNITS];
+	u32 capabilities;
+	u32 capabilitiesKnown; //Bits of capabilities that match GL, the rest haven't been set since the last reset
+	u32 blendSource, blendDestination;
+	u32 depthFunc;
+};
+
+static GLStateCache glState;
+GLCallStats glCallStats;
+
+static u32 GetCapabilityBit(u32 capability)
+{
+	switch (capability)
+	{
+	case GL_BLEND: return CAPABILITY_BLEND;
+	case GL_DEPTH_TEST: return CAPABILITY_DEPTH_TEST;
+	case GL_SCISSOR_TEST: return CAPABILITY_SCISSOR_TEST;
+	case GL_LINE_SMOOTH: return CAPABILITY_LINE_SMOOTH;
+	default: return 0;
+	}
+}
+
+void ResetGLStateCache()
+{
+	//Nothing is known, the next call of each kind always goes through
+	glState.program = GL_STATE_UNKNOWN;
+	glState.vertexArray = GL_STATE_UNKNOWN;
+	glState.arrayBuffer = GL_STATE_UNKNOWN;
+	glState.elementBuffer = GL_STATE_UNKNOWN;
+	glState.uniformBuffer = GL_STATE_UNKNOWN;
+	glState.activeUnit = GL_STATE_UNKNOWN;
+	for (u32& texture : glState.textures) texture = GL_STATE_UNKNOWN;
+	glState.blendSource = GL_STATE_UNKNOWN;
+	glState.blendDestination = GL_STATE_UNKNOWN;
+	glState.depthFunc = GL_STATE_UNKNOWN;
+	glState.capabilities = 0;
+	glState.capabilitiesKnown = 0;
+}
+
+void UseProgram(u32 id)
+{
+	if (glState.program == id)
+	{
+		glCallStats.programBindsSkipped++;
+		return;
+	}
+
+	glUseProgram(id);
+	glState.program = id;
+	glCallStats.programBinds++;
+}
+
+void BindVertexArray(u32 vao)
+{
+	if (glState.vertexArray == vao)
+	{
+		glCallStats.vertexArrayBindsSkipped++;
+		return;
+	}
+
+	glBindVertexArray(vao);
+	glState.vertexArray = vao;
+	glState.elementBuffer = GL_STATE_UNKNOWN;
+	glCallStats.vertexArrayBinds++;
+}
+
+void BindBuffer(u32 target, u32 buffer)
+{
+	u32* bound = target == GL_ARRAY_BUFFER ? &glState.arrayBuffer
+		: target == GL_ELEMENT_ARRAY_BUFFER ? &glState.elementBuffer
+		: target == GL_UNIFORM_BUFFER ? &glState.uniformBuffer
+		: nullptr;
+
+	if (bound != nullptr && *bound == buffer)
+	{
+		glCallStats.bufferBindsSkipped++;
+		return;
+	}
+
+	glBindBuffer(target, buffer);
+	if (bound != nullptr) *bound = buffer;
+	glCallStats.bufferBinds++;
+}
+
+void BindTexture(u32 id, u32 unit)
+{
+	assert(unit < GL_STATE_TEXTURE_UNITS);
+
+	//Callers upload and set parameters through the active unit, so select it even when the bind is skipped
+	if (glState.activeUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glState.activeUnit = unit;
+		glCallStats.stateChanges++;
+	}
+
+	if (glState.textures[unit] == id)
+	{
+		glCallStats.textureBindsSkipped++;
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, id);
+	glState.textures[unit] = id;
+	glCallStats.textureBinds++;
+}
+
+void SetCapability(u32 capability, bool enabled)
+{
+	u32 bit = GetCapabilityBit(capability);
+	if ((glState.capabilitiesKnown & bit) != 0 && ((glState.capabilities & bit) != 0) == enabled)
+	{
+		glCallStats.stateChangesSkipped++;
+		return;
+	}
+
+	if (enabled) glEnable(capability);
+	else glDisable(capability);
+
+	if (enabled) glState.capabilities |= bit;
+	else glState.capabilities &= ~bit;
+	glState.capabilitiesKnown |= bit;
+	glCallStats.stateChanges++;
+}
+
+void SetBlendFunc(u32 source, u32 destination)
+{
+	if (glState.blendSource == source && glState.blendDestination == destination)
+	{
+		glCallStats.stateChangesSkipped++;
+		return;
+	}
+
+	glBlendFunc(source, destination);
+	glState.blendSource = source;
+	glState.blendDestination = destination;
+	glCallStats.stateChanges++;
+}
+
+void SetDepthFunc(u32 func)
+{
+	if (glState.depthFunc == func)
+	{
+		glCallStats.stateChangesSkipped++;
+		return;
+	}
+
+	glDepthFunc(func);
+	glState.depthFunc = func;
+	glCallStats.stateChanges++;
+}
+
+void DeleteTexture(u32 id)
+{
+	for (u32& texture : glState.textures) if (texture == id) texture = 0;
+	glDeleteTextures(1, &id);
+}
 
-	if (shader->id != activeShaderID)
+void DeleteBuffer(u32 buffer)
+{
+	if (glState.arrayBuffer == buffer) glState.arrayBuffer = 0;
+	if (glState.elementBuffer == buffer) glState.elementBuffer = 0;
+	if (glState.uniformBuffer == buffer) glState.uniformBuffer = 0;
+	glDeleteBuffers(1, &buffer);
+}
+
+void DeleteVertexArray(u32 vao)
+{
+	if (glState.vertexArray == vao)
 	{
-		glUseProgram(shader->id);
-		activeShaderID = shader->id;
+		glState.vertexArray = 0;
+		glState.elementBuffer = 0;
 	}
+
+	glDeleteVertexArrays(1, &vao);
+}
+
+void DeleteProgram(u32 id)
+{
+	//A program in use is only deleted once it stops being used, so it has to be unbound to go now
+	if (glState.program == id) UseProgram(0);
+	glDeleteProgram(id);
+}
+
+u32 GLCallStats::Issued() const
+{
+	return programBinds + vertexArrayBinds + bufferBinds + textureBinds + stateChanges + uniformSets + drawCalls;
+}
+
+u32 GLCallStats::Skipped() const
+{
+	return programBindsSkipped + vertexArrayBindsSkipped + bufferBindsSkipped + textureBindsSkipped + stateChangesSkipped + uniformSetsSkipped;
+}
+
+GLCallStats GLCallStats::operator-(const GLCallStats& other) const
+{
+	GLCallStats result;
+	result.programBinds = programBinds - other.programBinds;
+	result.programBindsSkipped = programBindsSkipped - other.programBindsSkipped;
+	result.vertexArrayBinds = vertexArrayBinds - other.vertexArrayBinds;
+	result.vertexArrayBindsSkipped = vertexArrayBindsSkipped - other.vertexArrayBindsSkipped;
+	result.bufferBinds = bufferBinds - other.bufferBinds;
+	result.bufferBindsSkipped = bufferBindsSkipped - other.bufferBindsSkipped;
+	result.textureBinds = textureBinds - other.textureBinds;
+	result.textureBindsSkipped = textureBindsSkipped - other.textureBindsSkipped;
+	result.stateChanges = stateChanges - other.stateChanges;
+	result.stateChangesSkipped = stateChangesSkipped - other.stateChangesSkipped;
+	result.uniformSets = uniformSets - other.uniformSets;
+	result.uniformSetsSkipped = uniformSetsSkipped - other.uniformSetsSkipped;
+	result.drawCalls = drawCalls - other.drawCalls;
+	return result;
 }
 
 // dP     dP                     dP                     
@@ -89,11 +315,11 @@ VertBuffer::VertBuffer(VertexType vertexType)
 
 	//Generate and bind buffers
 	glGenVertexArrays(1, &vao);
-	glBindVertexArray(this->vao);
+	BindVertexArray(this->vao);
 	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	BindBuffer(GL_ARRAY_BUFFER, vbo);
 	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
 	//Set up vertex attributes
 	if (vertexType == POS_COLOR)
@@ -126,10 +352,8 @@ VertBuffer::VertBuffer(VertexType vertexType)
 		glEnableVertexAttribArray(2);
 	}
 
-	//Unbind
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	//Unbind so nothing else gets recorded into the vertex array
+	BindVertexArray(0);
 }
 
 void VertBuffer::Clear()
@@ -144,9 +368,9 @@ void VertBuffer::Clear()
 
 void VertBuffer::Destroy()
 {
-	glDeleteBuffers(1, &vbo);
-	glDeleteBuffers(1, &ebo);
-	glDeleteVertexArrays(1, &vao);
+	DeleteBuffer(vbo);
+	DeleteBuffer(ebo);
+	DeleteVertexArray(vao);
 }
 
 //  888888ba             dP            dP      
@@ -165,12 +389,12 @@ void RenderBatch::Draw()
 	if (buffer->vertexCount == 0) return;
 
 	SetActiveShader(shader);
-	glBindVertexArray(buffer->vao);
+	BindVertexArray(buffer->vao);
 
 	//Pass verts if necessary
 	if (buffer->dirty)
 	{
-		glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+		BindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
 
 		void* bufferData;
 		if (buffer->vertexType == POS_COLOR)
@@ -193,13 +417,16 @@ void RenderBatch::Draw()
 
 	if (shader->HasUniform(SHADER_MAIN_TEX))
 	{
+		//Glyphs may have been rasterised since the last draw
+		FlushGlyphAtlas();
+
 		//Pass texture
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture->id);
+		BindTexture(texture->id);
 		shader->SetUniformInt(SHADER_MAIN_TEX, 0);
 	}
 
 	glDrawElements(drawMode, (GLsizei)buffer->vertexIndices.size(), GL_UNSIGNED_INT, 0);
+	glCallStats.drawCalls++;
 }
 
 // .d88888b                    oo   dP            
@@ -239,24 +466,223 @@ SpriteSheet::SpriteSheet(Texture* texture, std::map<std::string, SpriteSequence>
 	this->sequences = sequences;
 }
 
+//Same ids as the source, pointing at the sheet's own copies of the sequences
+static void CopySequenceTable(SpriteSheet& sheet, const SpriteSheet& source)
+{
+	std::unordered_map<const SpriteSequence*, SpriteSequence*> copies;
+	auto copy = sheet.sequences.begin();
+	for (const auto& [name, sequence] : source.sequences) copies[&sequence] = &(copy++)->second;
+
+	sheet.sequenceTable.clear();
+	for (SpriteSequence* sequence : source.sequenceTable) sheet.sequenceTable.push_back(copies[sequence]);
+}
+
+SpriteSheet::SpriteSheet(const SpriteSheet& other)
+{
+	texture = other.texture;
+	sequences = other.sequences;
+	CopySequenceTable(*this, other);
+}
+
+SpriteSheet& SpriteSheet::operator=(const SpriteSheet& other)
+{
+	if (this == &other) return *this;
+
+	texture = other.texture;
+	sequences = other.sequences;
+	CopySequenceTable(*this, other);
+	return *this;
+}
+
+u32 SpriteSheet::GetSequenceID(const std::string& name)
+{
+	SpriteSequence* sequence = &sequences[name];
+
+	for (u32 id = 0; id < sequenceTable.size(); id++)
+	{
+		if (sequenceTable[id] == sequence) return id;
+	}
+
+	sequenceTable.push_back(sequence);
+	return (u32)sequenceTable.size() - 1;
+}
+
+//Sprite animations, kept dense so the update is a straight pass over each array. Handles index animationSlots, which
+//holds where each one currently sits in the arrays
+struct SpriteAnimations
+{
+	std::vector<float> time; //In frames, kept within 0 to frameCount
+	std::vector<float> speed;
+	std::vector<float> frameCount;
+	std::vector<u32> frame;
+	std::vector<vec4> uvRect;
+	std::vector<vec2> uvTextureSize; //Texture size uvRect was worked out for
+	std::vector<SpriteSheet*> sheet;
+	std::vector<u32> sequenceID;
+	std::vector<u32> handle;
+};
+
+static SpriteAnimations spriteAnimations;
+static std::vector<u32> animationSlots;
+static std::vector<u32> freeAnimationHandles;
+
+static void UpdateAnimationUVRect(u32 index)
+{
+	SpriteSequence* sequence = spriteAnimations.sheet[index]->sequenceTable[spriteAnimations.sequenceID[index]];
+	Texture* texture = spriteAnimations.sheet[index]->texture;
+	spriteAnimations.uvTextureSize[index] = texture->size;
+
+	if (sequence->frames.empty())
+	{
+		spriteAnimations.uvRect[index] = vec4(0, 0, 1, 1);
+		return;
+	}
+
+	Rect frameRect = sequence->frames[spriteAnimations.frame[index]].rect;
+	spriteAnimations.uvRect[index] = vec4(frameRect.min / texture->size, frameRect.max / texture->size);
+}
+
+static void SetAnimationSequence(u32 index, u32 sequenceID)
+{
+	SpriteSequence* sequence = spriteAnimations.sheet[index]->sequenceTable[sequenceID];
+
+	spriteAnimations.sequenceID[index] = sequenceID;
+	spriteAnimations.frameCount[index] = (float)std::max((u32)sequence->frames.size(), 1u);
+	spriteAnimations.time[index] = 0.f;
+	spriteAnimations.frame[index] = 0;
+	UpdateAnimationUVRect(index);
+}
+
+SpriteAnimator::SpriteAnimator(SpriteSheet* sheet, u32 sequenceID, float speed)
+{
+	if (!freeAnimationHandles.empty())
+	{
+		animation = freeAnimationHandles.back();
+		freeAnimationHandles.pop_back();
+	}
+	else
+	{
+		animation = (u32)animationSlots.size();
+		animationSlots.emplace_back();
+	}
+
+	u32 index = (u32)spriteAnimations.time.size();
+	animationSlots[animation] = index;
+
+	spriteAnimations.time.push_back(0.f);
+	spriteAnimations.speed.push_back(speed);
+	spriteAnimations.frameCount.push_back(1.f);
+	spriteAnimations.frame.push_back(0);
+	spriteAnimations.uvRect.emplace_back();
+	spriteAnimations.uvTextureSize.emplace_back();
+	spriteAnimations.sheet.push_back(sheet);
+	spriteAnimations.sequenceID.push_back(sequenceID);
+	spriteAnimations.handle.push_back(animation);
+
+	SetAnimationSequence(index, sequenceID);
+}
+
 SpriteAnimator::SpriteAnimator(SpriteSheet* sheet, std::string sequenceName, float speed)
+	: SpriteAnimator(sheet, sheet->GetSequenceID(sequenceName), speed) { }
+
+void SpriteAnimator::Destroy()
 {
-	this->sheet = sheet;
-	sequence = &this->sheet->sequences[sequenceName];
-	this->timer = CreateTimer();
-	this->timer->speed = speed;
+	assert(animation < animationSlots.size());
+
+	//Fill the hole with the last animation so the arrays stay packed
+	u32 index = animationSlots[animation];
+	u32 last = (u32)spriteAnimations.time.size() - 1;
+
+	spriteAnimations.time[index] = spriteAnimations.time[last];
+	spriteAnimations.speed[index] = spriteAnimations.speed[last];
+	spriteAnimations.frameCount[index] = spriteAnimations.frameCount[last];
+	spriteAnimations.frame[index] = spriteAnimations.frame[last];
+	spriteAnimations.uvRect[index] = spriteAnimations.uvRect[last];
+	spriteAnimations.uvTextureSize[index] = spriteAnimations.uvTextureSize[last];
+	spriteAnimations.sheet[index] = spriteAnimations.sheet[last];
+	spriteAnimations.sequenceID[index] = spriteAnimations.sequenceID[last];
+	spriteAnimations.handle[index] = spriteAnimations.handle[last];
+	animationSlots[spriteAnimations.handle[index]] = index;
+
+	spriteAnimations.time.pop_back();
+	spriteAnimations.speed.pop_back();
+	spriteAnimations.frameCount.pop_back();
+	spriteAnimations.frame.pop_back();
+	spriteAnimations.uvRect.pop_back();
+	spriteAnimations.uvTextureSize.pop_back();
+	spriteAnimations.sheet.pop_back();
+	spriteAnimations.sequenceID.pop_back();
+	spriteAnimations.handle.pop_back();
+
+	freeAnimationHandles.push_back(animation);
+	animation = SPRITE_ANIMATION_NONE;
 }
 
 u32 SpriteAnimator::GetFrame()
 {
-	if ((u32)timer->timeElapsed == 0 || sequence->frames.size() == 0) return 0;
-	return (u32)timer->timeElapsed % sequence->frames.size();
+	return spriteAnimations.frame[animationSlots[animation]];
+}
+
+SpriteSequence* SpriteAnimator::GetSequence()
+{
+	u32 index = animationSlots[animation];
+	return spriteAnimations.sheet[index]->sequenceTable[spriteAnimations.sequenceID[index]];
+}
+
+vec4 SpriteAnimator::GetUVRect()
+{
+	u32 index = animationSlots[animation];
+
+	//Async loads and hot reloads can resize the texture under the cached UVs
+	if (spriteAnimations.sheet[index]->texture->size != spriteAnimations.uvTextureSize[index]) UpdateAnimationUVRect(index);
+
+	return spriteAnimations.uvRect[index];
+}
+
+void SpriteAnimator::SetSequence(u32 sequenceID)
+{
+	SetAnimationSequence(animationSlots[animation], sequenceID);
 }
 
 void SpriteAnimator::SetSequence(std::string name)
 {
-	sequence = &sheet->sequences[name];
-	this->timer->Reset();
+	u32 index = animationSlots[animation];
+	SetAnimationSequence(index, spriteAnimations.sheet[index]->GetSequenceID(name));
+}
+
+void SpriteAnimator::SetSpeed(float speed)
+{
+	spriteAnimations.speed[animationSlots[animation]] = speed;
+}
+
+void UpdateSpriteAnimations(float dt)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	size_t count = spriteAnimations.time.size();
+	float* time = spriteAnimations.time.data();
+	const float* speed = spriteAnimations.speed.data();
+	const float* frameCount = spriteAnimations.frameCount.data();
+	u32* frame = spriteAnimations.frame.data();
+
+	//Branch free so it vectorises, wrapping keeps time small enough that float precision never runs out
+	for (size_t i = 0; i < count; i++)
+	{
+		float t = time[i] + speed[i] * dt;
+		time[i] = t - frameCount[i] * floorf(t / frameCount[i]);
+	}
+
+	//Only animators that moved onto a new frame need their UVs worked out again
+	for (size_t i = 0; i < count; i++)
+	{
+		u32 newFrame = std::min((u32)time[i], (u32)frameCount[i] - 1);
+		if (newFrame == frame[i]) continue;
+
+		frame[i] = newFrame;
+		UpdateAnimationUVRect((u32)i);
+	}
 }
 
 SpriteBatch::SpriteBatch(VertBuffer* vertBuffer, Shader* shader, SpriteSheet* spriteSheet)
@@ -267,12 +693,31 @@ SpriteBatch::SpriteBatch(VertBuffer* vertBuffer, Shader* shader, SpriteSheet* sp
 	this->texture = spriteSheet->texture;
 }
 
+//Copy of the sprite placed by its interpolated transform
+static Sprite ApplySpriteTransform(const Sprite& sprite)
+{
+	Transform2D transform = GetInterpolatedTransform(sprite.transform);
+
+	Sprite result = sprite;
+	result.position = transform.position;
+	result.rotation = transform.rotation;
+	result.size *= transform.scale;
+	result.transform = TRANSFORM_NONE;
+	return result;
+}
+
 void SpriteBatch::PushSprite(const Sprite& sprite)
 {
 #ifdef TRACY_ENABLE
 	ZoneScoped;
 #endif
 
+	if (sprite.transform != TRANSFORM_NONE)
+	{
+		PushSprite(ApplySpriteTransform(sprite));
+		return;
+	}
+
 	buffer->dirty = true;
 	
 	//Switch to 9 Slice function if the margin is not zero
@@ -328,28 +773,19 @@ void SpriteBatch::PushSprite(const Sprite& sprite)
 	else if (buffer->vertexType == POS_UV || buffer->vertexType == POS_UV_COLOR)
 	{
 		//POS_UV needs to get the spritesheet data. 
-		SpriteSequence* sequence = nullptr;
-		u32 frame;
+		vec2 uvMin = vec2(0);
+		vec2 uvMax = vec2(1);
 
-		//Prefer using animator over sequence if it is set
+		//Prefer using animator over sequence if it is set, animators already have their current UVs worked out
 		if (sprite.animator != nullptr)
 		{
-			sequence = sprite.animator->sequence;
-			frame = sprite.animator->GetFrame();
+			vec4 uvRect = sprite.animator->GetUVRect();
+			uvMin = vec2(uvRect.x, uvRect.y);
+			uvMax = vec2(uvRect.z, uvRect.w);
 		}
 		else if (sprite.sequence != nullptr)
 		{
-			sequence = sprite.sequence;
-			frame = sprite.sequenceFrame;
-		}
-
-		//Calculate UVs
-		vec2 uvMin = vec2(0);
-		vec2 uvMax = vec2(1);
-		
-		if (sequence != nullptr)
-		{
-			Rect frameRect = sequence->frames[frame].rect;
+			Rect frameRect = sprite.sequence->frames[sprite.sequenceFrame].rect;
 			uvMin = frameRect.min / texture->size;
 			uvMax = frameRect.max / texture->size;
 		}
@@ -410,7 +846,7 @@ void SpriteBatch::PushSprite9Slice(const Sprite& sprite)
 
 	if (sprite.animator != nullptr)
 	{
-		sequence = sprite.animator->sequence;
+		sequence = sprite.animator->GetSequence();
 		frame = &sequence->frames[sprite.animator->GetFrame()];
 	}
 	else if (sprite.sequence != nullptr)
@@ -553,6 +989,44 @@ void TextBatch::PushText(const Text& text)
 
 void TextBatch::PushText(const Text& text, TextRenderInfo& info)
 {
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	if (text.data == "") return;
+
+	TextLayout layout;
+	LayoutText(text, layout);
+	PushTextLayout(layout, text.position, text.color);
+	info = std::move(layout.info);
+}
+
+void TextBatch::PushTextCached(const Text& text)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	if (text.data == "") return;
+
+	PushTextLayout(GetCachedTextLayout(text), text.position, text.color);
+}
+
+void TextBatch::PushTextCached(const Text& text, TextRenderInfo& info)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	if (text.data == "") return;
+
+	const TextLayout& layout = GetCachedTextLayout(text);
+	PushTextLayout(layout, text.position, text.color);
+	info = layout.info;
+}
+
+void TextBatch::PushTextLayout(const TextLayout& layout, vec3 position, vec4 color)
+{
 #ifdef TRACY_ENABLE
 	ZoneScoped;
 #endif
@@ -560,17 +1034,89 @@ void TextBatch::PushText(const Text& text, TextRenderInfo& info)
 	//UV channel is required for text
 	assert(buffer->vertexType != POS_COLOR);
 
-	if (text.data == "") return;
+	if (layout.glyphRects.empty()) return;
 
 	buffer->dirty = true;
 
+	for (const FontCharacterRect& glyphRect : layout.glyphRects)
+	{
+		vec2 pos = glyphRect.position + vec2(position.x, position.y);
+
+		vec3 positions[] = {
+			vec3(pos, position.z),
+			vec3(pos.x, pos.y + glyphRect.size.y, position.z),
+			vec3(pos + glyphRect.size, position.z),
+			vec3(pos.x + glyphRect.size.x, pos.y, position.z)
+		};
+
+		vec2 UVs[] = {
+			vec2(glyphRect.uvMin.x, glyphRect.uvMax.y),
+			glyphRect.uvMin,
+			vec2(glyphRect.uvMax.x, glyphRect.uvMin.y),
+			glyphRect.uvMax
+		};
+
+		if (buffer->vertexType == POS_UV_COLOR)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				buffer->posUVColorVerts.push_back({ positions[i], UVs[i], color });
+			}
+		}
+		else
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				buffer->posUVVerts.push_back({ positions[i], UVs[i] });
+			}
+		}
+
+		buffer->vertexIndices.push_back(buffer->vertexCount + 0);
+		buffer->vertexIndices.push_back(buffer->vertexCount + 1);
+		buffer->vertexIndices.push_back(buffer->vertexCount + 2);
+		buffer->vertexIndices.push_back(buffer->vertexCount + 2);
+		buffer->vertexIndices.push_back(buffer->vertexCount + 3);
+		buffer->vertexIndices.push_back(buffer->vertexCount + 0);
+
+		buffer->vertexCount += 4;
+	}
+}
+
+//Decodes one UTF-8 sequence, malformed bytes are passed through as their Latin-1 codepoint
+static i32 DecodeUTF8(std::string::const_iterator it, std::string::const_iterator end, u32& byteCount)
+{
+	u8 lead = (u8)*it;
+	byteCount = 1;
+
+	if (lead < 0x80) return lead;
+
+	u32 length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+	if (length == 0 || lead > 0xF4 || end - it < (i64)length) return lead;
+
+	i32 codepoint = lead & (0x7F >> length);
+	for (u32 i = 1; i < length; i++)
+	{
+		u8 next = (u8)*(it + i);
+		if ((next & 0xC0) != 0x80) return lead;
+		codepoint = (codepoint << 6) | (next & 0x3F);
+	}
+
+	byteCount = length;
+	return codepoint;
+}
+
+void LayoutText(const Text& text, TextLayout& layout)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	TextRenderInfo& info = layout.info;
+	layout.glyphRects.reserve(text.data.size());
+
 	vec2 actualSize = text.scale * text.textSize;
 	vec2 origin = vec2(0); //Origin represents the rolling glyph position before it is scaled
 
-	//Create temporary array of rectangles, this is so we can replace things after the fact.
-	std::vector<FontCharacterRect> glyphRects;
-	glyphRects.reserve(text.data.size());
-
 	//TODO: Make extents y based on line height not glyph height
 	vec2 extents = vec2(0);
 	//info.caretPositionOffsets = std::vector<vec2>(1, vec2(0));
@@ -581,15 +1127,15 @@ void TextBatch::PushText(const Text& text, TextRenderInfo& info)
 	//we can calculate the extents of the rendered text to later shift the coordinates
 	//around the pivot point
 	u32 index = 0;
-	for (auto it = text.data.begin(); it != text.data.end(); it++)
+	for (auto it = text.data.begin(); it != text.data.end();)
 	{
-		FontCharacter* glyph = &text.font->characters[*it];
+		u32 byteCount;
+		i32 codepoint = DecodeUTF8(it, text.data.end(), byteCount);
+		const FontCharacter* glyph = &text.font->GetGlyph(codepoint);
 
 		vec2 glyphPos = (origin + vec2(glyph->bearing.x, glyph->bearing.y - glyph->size.y)) * actualSize;
 		vec2 glyphSize = glyph->size * actualSize;
 
-		
-
 		//TODO: Implement smarter new-lining that doesn't split words
 		bool newLine = false;
 
@@ -619,62 +1165,120 @@ void TextBatch::PushText(const Text& text, TextRenderInfo& info)
 		if (glyphPos.x + glyphSize.x > extents.x) extents.x = glyphPos.x + glyphSize.x;
 		if (glyphPos.y + glyphSize.y > extents.y) extents.y = glyphPos.y + glyphSize.y;
 
-		//Move glyph into world space
-		glyphPos += vec2(text.position.x, text.position.y);
+		//Caret offsets stay per byte so they line up with string indices, continuation bytes share the character's offset
+		for (u32 i = 1; i < byteCount; i++)
+		{
+			info.caretPositionOffsets.push_back(origin * actualSize);
+			index++;
+		}
 
 		origin.x += glyph->advance;
 		//info.caretPositionOffsets.push_back(origin * actualSize);
 
-		glyphRects.push_back({ glyphPos, glyphSize, glyph });
-		
+		layout.glyphRects.push_back({ glyphPos, glyphSize, glyph->uvMin, glyph->uvMax });
+
 		index++;
+		it += byteCount;
 	}
 
 	info.caretPositionOffsets.push_back(origin * actualSize);
 
+	//Shift glyphs around the pivot point, positions stay relative to the text position
 	vec2 offset = ((text.extents) - extents) * text.alignment;
+	for (FontCharacterRect& glyphRect : layout.glyphRects) glyphRect.position += offset;
+}
 
-	for (const FontCharacterRect& glyphRect : glyphRects)
-	{
-		vec2 pos = glyphRect.position + offset;
+//Text layout cache, entries that go unused for this many frames are evicted
+#define TEXT_LAYOUT_CACHE_MAX_AGE 120
 
-		vec3 positions[] = {
-			vec3(pos, text.position.z),
-			vec3(pos.x, pos.y + glyphRect.size.y, text.position.z),
-			vec3(pos + glyphRect.size, text.position.z),
-			vec3(pos.x + glyphRect.size.x, pos.y, text.position.z)
-		};
+struct TextLayoutKey
+{
+	std::string data;
+	Font* font;
+	float textSize;
+	vec2 scale;
+	vec2 extents;
+	vec2 alignment;
+
+	bool operator==(const TextLayoutKey& other) const
+	{
+		return font == other.font
+			&& textSize == other.textSize
+			&& scale == other.scale
+			&& extents == other.extents
+			&& alignment == other.alignment
+			&& data == other.data;
+	}
+};
 
-		vec2 UVs[] = {
-			vec2(glyphRect.character->uvMin.x, glyphRect.character->uvMax.y),
-			glyphRect.character->uvMin,
-			vec2(glyphRect.character->uvMax.x, glyphRect.character->uvMin.y),
-			glyphRect.character->uvMax
-		};
+struct TextLayoutKeyHasher
+{
+	std::size_t operator()(const TextLayoutKey& key) const
+	{
+		std::size_t hash = std::hash<std::string>()(key.data);
+		float values[] = { key.textSize, key.scale.x, key.scale.y, key.extents.x, key.extents.y, key.alignment.x, key.alignment.y };
 
-		if (buffer->vertexType == POS_UV_COLOR)
-		{
-			for (int i = 0; i < 4; i++)
-			{
-				buffer->posUVColorVerts.push_back({ positions[i], UVs[i], text.color });
-			}
-		}
-		else
+		hash ^= std::hash<Font*>()(key.font) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		for (float value : values)
 		{
-			for (int i = 0; i < 4; i++)
-			{
-				buffer->posUVVerts.push_back({ positions[i], UVs[i] });
-			}
+			hash ^= std::hash<float>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
 		}
 
-		buffer->vertexIndices.push_back(buffer->vertexCount + 0);
-		buffer->vertexIndices.push_back(buffer->vertexCount + 1);
-		buffer->vertexIndices.push_back(buffer->vertexCount + 2);
-		buffer->vertexIndices.push_back(buffer->vertexCount + 2);
-		buffer->vertexIndices.push_back(buffer->vertexCount + 3);
-		buffer->vertexIndices.push_back(buffer->vertexCount + 0);
+		return hash;
+	}
+};
 
-		buffer->vertexCount += 4;
+struct CachedTextLayout
+{
+	TextLayout layout;
+	u32 lastUsedFrame;
+	u32 glyphAtlasGeneration;
+};
+
+static std::unordered_map<TextLayoutKey, CachedTextLayout, TextLayoutKeyHasher> textLayoutCache;
+static u32 textLayoutFrame;
+
+const TextLayout& GetCachedTextLayout(const Text& text)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	TextLayoutKey key = { text.data, text.font, text.textSize, text.scale, text.extents, text.alignment };
+	auto it = textLayoutCache.find(key);
+
+	if (it == textLayoutCache.end())
+	{
+		CachedTextLayout entry;
+		LayoutText(text, entry.layout);
+		entry.glyphAtlasGeneration = GetGlyphAtlasGeneration();
+		it = textLayoutCache.emplace(std::move(key), std::move(entry)).first;
+	}
+	else if (it->second.glyphAtlasGeneration != GetGlyphAtlasGeneration())
+	{
+		//Glyphs moved when the atlas was compacted
+		it->second.layout = TextLayout();
+		LayoutText(text, it->second.layout);
+		it->second.glyphAtlasGeneration = GetGlyphAtlasGeneration();
+	}
+
+	it->second.lastUsedFrame = textLayoutFrame;
+	return it->second.layout;
+}
+
+void TrimTextLayoutCache()
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	textLayoutFrame++;
+	if (textLayoutFrame % TEXT_LAYOUT_CACHE_MAX_AGE != 0) return;
+
+	for (auto it = textLayoutCache.begin(); it != textLayoutCache.end();)
+	{
+		if (textLayoutFrame - it->second.lastUsedFrame > TEXT_LAYOUT_CACHE_MAX_AGE) it = textLayoutCache.erase(it);
+		else it++;
 	}
 }
 
@@ -682,12 +1286,15 @@ void DebugPrintFontData(Font* font)
 {
 	std::cout << "DEBUG PRINT FONT:\n\n";
 
-	for (auto it = font->characters.begin(); it != font->characters.end(); it++)
+	for (i32 c = 0; c < FONT_DIRECT_GLYPH_COUNT; c++)
 	{
-		std::cout << it->first;
-		std::cout << ":  bearing=(" << std::to_string(it->second.bearing.x) << "," << std::to_string(it->second.bearing.x) << ")	";
-		std::cout << "size=(" << std::to_string(it->second.size.x) << "," << std::to_string(it->second.size.x) << ")	";
-		std::cout << "advance=" << std::to_string(it->second.advance) << "\n";
+		if (!font->HasGlyph(c)) continue;
+
+		const FontCharacter& character = font->GetGlyph(c);
+		std::cout << c;
+		std::cout << ":  bearing=(" << std::to_string(character.bearing.x) << "," << std::to_string(character.bearing.x) << ")	";
+		std::cout << "size=(" << std::to_string(character.size.x) << "," << std::to_string(character.size.x) << ")	";
+		std::cout << "advance=" << std::to_string(character.advance) << "\n";
 	}
 
 	std::cout << "\n";
@@ -738,6 +1345,35 @@ void RenderQueue::AddStep(void(*preDraw)(), void(*postDraw)())
 	stepIndex++;
 }
 
+//Start a new step with a pixel-space scissor rect, if the current step is still empty it is reused
+void RenderQueue::SetScissor(vec2 pos, vec2 size)
+{
+	if ((size_t)stepIndex + 1 > steps.size())
+	{
+		for (u32 diff = (stepIndex + 1) - steps.size(); diff != 0; diff--)
+		{
+			steps.push_back(Step());
+		}
+	}
+
+	if (steps[stepIndex].spriteBatchIndex != -1 || steps[stepIndex].textBatchIndex != -1 || steps[stepIndex].sdfTextBatchIndex != -1)
+	{
+		AddStep();
+	}
+
+	steps[stepIndex].scissor = true;
+	steps[stepIndex].scissorPos = pos;
+	steps[stepIndex].scissorSize = size;
+}
+
+void RenderQueue::ClearScissor()
+{
+	if (stepIndex < steps.size() && steps[stepIndex].scissor)
+	{
+		AddStep();
+	}
+}
+
 void RenderQueue::PushSprite(const Sprite& sprite)
 {
 #ifdef TRACY_ENABLE
@@ -792,6 +1428,22 @@ void RenderQueue::PushText(const Text& text, TextRenderInfo& info)
 	ZoneScoped;
 #endif
 
+	GetTextBatch(text.font->sdf)->PushText(text, info);
+}
+
+void RenderQueue::PushTextCached(const Text& text)
+{
+	GetTextBatch(text.font->sdf)->PushTextCached(text);
+}
+
+void RenderQueue::PushTextCached(const Text& text, TextRenderInfo& info)
+{
+	GetTextBatch(text.font->sdf)->PushTextCached(text, info);
+}
+
+//Returns the text batch of the current step, creating it if needed. SDF fonts get their own batch since they need a different shader
+TextBatch* RenderQueue::GetTextBatch(bool sdf)
+{
 	u32 textBatchIndex;
 
 	//Create new steps if the index has grown past the current size
@@ -803,10 +1455,12 @@ void RenderQueue::PushText(const Text& text, TextRenderInfo& info)
 		}
 	}
 
-	if (steps[stepIndex].textBatchIndex != -1)
+	i32& stepTextBatchIndex = sdf ? steps[stepIndex].sdfTextBatchIndex : steps[stepIndex].textBatchIndex;
+
+	if (stepTextBatchIndex != -1)
 	{
-		//Sprite batch for this step already exists
-		textBatchIndex = steps[stepIndex].textBatchIndex;
+		//Text batch for this step already exists
+		textBatchIndex = stepTextBatchIndex;
 	}
 	else
 	{
@@ -822,11 +1476,14 @@ void RenderQueue::PushText(const Text& text, TextRenderInfo& info)
 		}
 
 		textBatchIndex = currentTextBatchIndex;
-		steps[stepIndex].textBatchIndex = textBatchIndex;
+		stepTextBatchIndex = textBatchIndex;
 		currentTextBatchIndex++;
+
+		//Batches are pooled between both kinds of text, so the shader is picked each time one is handed out
+		textBatches[textBatchIndex].shader = sdf && sdfTextShader != nullptr ? sdfTextShader : textShader;
 	}
 
-	textBatches[textBatchIndex].PushText(text, info);
+	return &textBatches[textBatchIndex];
 }
 
 void RenderQueue::Draw()
@@ -835,9 +1492,18 @@ void RenderQueue::Draw()
 	ZoneScoped;
 #endif
 
+	GLCallStats statsBefore = glCallStats;
+
 	//Iterate through steps in queue, triggering events and drawing their contents. Sprites draw before text.
 	for (u32 i = 0; i < steps.size(); i++)
 	{
+		SetCapability(GL_SCISSOR_TEST, steps[i].scissor);
+		if (steps[i].scissor)
+		{
+			glScissor((GLint)steps[i].scissorPos.x, (GLint)steps[i].scissorPos.y,
+				(GLsizei)glm::max(steps[i].scissorSize.x, 0.f), (GLsizei)glm::max(steps[i].scissorSize.y, 0.f));
+		}
+
 		if (steps[i].preDraw != nullptr) steps[i].preDraw();
 
 		i32 sbIndex = steps[i].spriteBatchIndex;
@@ -852,8 +1518,18 @@ void RenderQueue::Draw()
 			textBatches[tbIndex].Draw();
 		}
 
+		i32 sdfTbIndex = steps[i].sdfTextBatchIndex;
+		if (sdfTbIndex != -1)
+		{
+			textBatches[sdfTbIndex].Draw();
+		}
+
 		if (steps[i].postDraw != nullptr) steps[i].postDraw();
 	}
+
+	SetCapability(GL_SCISSOR_TEST, false);
+
+	drawStats = glCallStats - statsBefore;
 }
 
 //  a88888b.                                                
@@ -881,9 +1557,8 @@ void SetCameraPosition(vec2 position, bool forceUpdateUBO)
 		//Step view matrix
 		vec3 pos = vec3(position.x, position.y, 1);
 		cameraView = glm::lookAt(pos, pos + vec3(0, 0, -1), vec3(0, 1, 0));
-		glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+		BindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
 		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4), sizeof(mat4), glm::value_ptr(cameraView));
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 		 
 		cameraViewProj = cameraProjection * cameraView;
 		cameraViewProjInverse = glm::inverse(cameraViewProj);
@@ -911,9 +1586,8 @@ void SetCameraSize(float size, bool forceUpdateUBO)
 		float halfWidth = GetWindowSize().x * actualCameraSize * 0.5f;
 		float halfHeight = GetWindowSize().y * actualCameraSize * 0.5f;
 		cameraProjection = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight);
-		glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+		BindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
 		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4), glm::value_ptr(cameraProjection));
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
 		cameraViewProj = cameraProjection * cameraView;
 		cameraViewProjInverse = glm::inverse(cameraViewProj);
@@ -2,6 +2,31 @@
 
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#undef APIENTRY
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "bingus_pack.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -24,39 +49,226 @@ static std::unordered_map<std::string, Texture> textures;
 static std::unordered_map<std::string, Shader> shaders;
 static std::unordered_map<std::string, Font> fonts;
 
-Texture* LoadTexture(std::string filenameAndPath)
+//Hot reload, see EnableResourceHotReload
+enum WatchedFileType { WATCHED_TEXTURE, WATCHED_SHADER };
+static void WatchResourceFile(const std::string& fullPath, WatchedFileType type, const std::string& name);
+
+//Mounted resource pack, entries are looked up by the same names the loaders are called with
+static const u8* packData = nullptr;
+static size_t packSize = 0;
+static std::unordered_map<std::string, const BingusPackEntry*> packEntries[BINGUS_PACK_TYPE_COUNT];
+static std::mutex packMutex; //Held by mount and unmount, and by loader threads while they read from the pack
+#ifdef _WIN32
+static HANDLE packFile = INVALID_HANDLE_VALUE;
+static HANDLE packMapping = nullptr;
+#endif
+
+static void UnmountResourcePackLocked();
+
+static const BingusPackEntry* FindPackEntry(BingusPackEntryType type, const std::string& name)
+{
+	if (packData == nullptr) return nullptr;
+
+	auto it = packEntries[type].find(name);
+	return it != packEntries[type].end() ? it->second : nullptr;
+}
+
+//Everything read out of an entry later is checked here once, so a truncated or corrupt pack can't send reads past
+//the entry or the mapping
+static bool IsPackEntryValid(const BingusPackEntry& entry)
+{
+	if (entry.type >= BINGUS_PACK_TYPE_COUNT) return false;
+	if (memchr(entry.name, 0, BINGUS_PACK_NAME_LENGTH) == nullptr) return false;
+	if (entry.offset > packSize || entry.size > packSize - entry.offset) return false;
+	if (entry.type != BINGUS_PACK_TEXTURE) return true;
+
+	//A full chain halves down to 1x1, so anything over 32 levels is garbage
+	if (entry.width == 0 || entry.height == 0 || entry.mipCount == 0 || entry.mipCount > 32) return false;
+
+	u64 chainSize = 0;
+	u64 width = entry.width;
+	u64 height = entry.height;
+	for (u32 mip = 0; mip < entry.mipCount; mip++)
+	{
+		chainSize += width * height * 4;
+		if (chainSize > entry.size) return false;
+		width = std::max(width / 2, (u64)1);
+		height = std::max(height / 2, (u64)1);
+	}
+
+	return true;
+}
+
+bool MountResourcePack(std::string filePath)
 {
 #ifdef TRACY_ENABLE
 	ZoneScoped;
 #endif
 
-	if (textures.find(filenameAndPath) != textures.end())
+	std::lock_guard<std::mutex> lock(packMutex);
+	UnmountResourcePackLocked();
+
+	//Map the whole file, nothing is copied out of it until GL takes the data
+#ifdef _WIN32
+	packFile = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (packFile == INVALID_HANDLE_VALUE)
 	{
-		//Return pointer to existing texture
-		return &textures[filenameAndPath];
+		std::cout << "Failed to mount resource pack! : file not found: " << filePath << "\n";
+		return false;
 	}
 
-	//Default wrap and filter modes
-	Texture texture;
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(packFile, &fileSize);
+	packMapping = CreateFileMappingA(packFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* mapped = packMapping != nullptr ? MapViewOfFile(packMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (mapped == nullptr)
+	{
+		std::cout << "Failed to mount resource pack! : could not map " << filePath << "\n";
+		UnmountResourcePackLocked();
+		return false;
+	}
 
-	texture.cachedWrapMode = GL_REPEAT;
-	texture.cachedFilterMode = GL_LINEAR_MIPMAP_LINEAR;
+	packSize = (size_t)fileSize.QuadPart;
+#else
+	int file = open(filePath.c_str(), O_RDONLY);
+	if (file == -1)
+	{
+		std::cout << "Failed to mount resource pack! : file not found: " << filePath << "\n";
+		return false;
+	}
+
+	struct stat fileStat;
+	fstat(file, &fileStat);
+	void* mapped = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (mapped == MAP_FAILED)
+	{
+		std::cout << "Failed to mount resource pack! : could not map " << filePath << "\n";
+		return false;
+	}
+
+	packSize = (size_t)fileStat.st_size;
+#endif
+
+	packData = (const u8*)mapped;
+
+	const BingusPackHeader* header = (const BingusPackHeader*)packData;
+	if (packSize < sizeof(BingusPackHeader) || header->magic != BINGUS_PACK_MAGIC || header->version != BINGUS_PACK_VERSION
+		|| packSize < sizeof(BingusPackHeader) + sizeof(BingusPackEntry) * (size_t)header->entryCount)
+	{
+		std::cout << "Failed to mount resource pack! : " << filePath << " is not a version " << BINGUS_PACK_VERSION << " pack\n";
+		UnmountResourcePackLocked();
+		return false;
+	}
+
+	const BingusPackEntry* entries = (const BingusPackEntry*)(packData + sizeof(BingusPackHeader));
+	for (u32 i = 0; i < header->entryCount; i++)
+	{
+		if (!IsPackEntryValid(entries[i]))
+		{
+			std::cout << "Skipping resource pack entry " << i << " in " << filePath << " : truncated or corrupt\n";
+			continue;
+		}
+
+		packEntries[entries[i].type][std::string(entries[i].name)] = &entries[i];
+	}
+
+	std::cout << "Resource pack mounted : @" << filePath << " (" << header->entryCount << " resources)\n";
+	return true;
+}
+
+static void UnmountResourcePackLocked()
+{
+	for (auto& entries : packEntries) entries.clear();
+
+#ifdef _WIN32
+	if (packData != nullptr) UnmapViewOfFile(packData);
+	if (packMapping != nullptr) CloseHandle(packMapping);
+	if (packFile != INVALID_HANDLE_VALUE) CloseHandle(packFile);
+	packMapping = nullptr;
+	packFile = INVALID_HANDLE_VALUE;
+#else
+	if (packData != nullptr) munmap((void*)packData, packSize);
+#endif
+
+	packData = nullptr;
+	packSize = 0;
+}
+
+void UnmountResourcePack()
+{
+	std::lock_guard<std::mutex> lock(packMutex);
+	UnmountResourcePackLocked();
+}
+
+//Mipmapped minification filters aren't valid for magnification, they map to the filter they use within a level
+static i32 MagFilterFor(i32 filterMode)
+{
+	switch (filterMode)
+	{
+	case GL_NEAREST:
+	case GL_NEAREST_MIPMAP_NEAREST:
+	case GL_NEAREST_MIPMAP_LINEAR:
+		return GL_NEAREST;
+	default:
+		return GL_LINEAR;
+	}
+}
+
+//Uploads a pre-decoded texture and its mip chain straight out of the mapped pack
+static void CreateTextureFromPack(Texture& texture, const BingusPackEntry* entry)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
 
 	glGenTextures(1, &texture.id);
-	glBindTexture(GL_TEXTURE_2D, texture.id);
+	BindTexture(texture.id);
 
 	//Set parameters
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.cachedWrapMode);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.cachedWrapMode);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.cachedFilterMode);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.cachedFilterMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilterFor(texture.cachedFilterMode));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (i32)entry->mipCount - 1);
 
-	//Load texture from file
-	int width, height, nrChannels;
-	stbi_set_flip_vertically_on_load(true);
+	texture.size = vec2(entry->width, entry->height);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	const u8* level = packData + entry->offset;
+	u32 width = entry->width;
+	u32 height = entry->height;
+	texture.memorySize = 0;
+	for (u32 mip = 0; mip < entry->mipCount; mip++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, mip, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+		level += (size_t)width * height * 4;
+		texture.memorySize += (u64)width * height * 4;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+
+	std::cout << "Texture created : @" << entry->name << " (pack)\n";
+}
+
+//Creates the GL texture for decoded pixels using the texture's cached wrap and filter modes
+static void CreateTexture(Texture& texture, unsigned char* textureData, i32 width, i32 height, i32 nrChannels, const string& fullPath)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	//Reloads upload into the existing id so anything holding the texture keeps working
+	if (texture.id == 0) glGenTextures(1, &texture.id);
+	BindTexture(texture.id);
+
+	//Set parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.cachedWrapMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.cachedWrapMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.cachedFilterMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilterFor(texture.cachedFilterMode));
 
-	string full_path = string(TEXTURE_PATH) + filenameAndPath;
-	unsigned char* textureData = stbi_load(full_path.c_str(), &width, &height, &nrChannels, 0);
 	texture.size = vec2(width, height);
 
 	//Detect format
@@ -75,277 +287,2253 @@ Texture* LoadTexture(std::string filenameAndPath)
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, imageFormat, GL_UNSIGNED_BYTE, textureData);
 		glGenerateMipmap(GL_TEXTURE_2D);
+
+		//RGBA8 plus roughly a third again for the mip chain
+		texture.memorySize = (u64)width * height * 4 * 4 / 3;
 	}
 	else
 	{
-		std::cout << "Image load failed! : @" << full_path << "\n";
-		stbi_image_free(textureData);
+		std::cout << "Image load failed! : @" << fullPath << "\n";
 		//TODO: Implement proper error return code??
 	}
 
-	std::cout << "Texture created : @" << full_path << "\n";
-	
-	textures[filenameAndPath] = texture;
-	return &textures[filenameAndPath];
+	std::cout << "Texture created : @" << fullPath << "\n";
 }
 
-void Texture::SetWrapMode(i32 wrapMode)
+//DDS loading, block compressed textures upload their stored mip chain as-is. Like every other texture they are
+//expected bottom row first, bingus_pack --dds writes them that way
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#define DDS_MAGIC						0x20534444 //"DDS "
+#define DDS_FOURCC(a, b, c, d)			((u32)(a) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
+#define DDS_PIXEL_FORMAT_FOURCC			0x4
+#define DXGI_FORMAT_BC1_UNORM			71
+#define DXGI_FORMAT_BC3_UNORM			77
+#define DXGI_FORMAT_BC7_UNORM			98
+
+struct DDSPixelFormat
 {
-	cachedWrapMode = wrapMode;
-	glBindTexture(GL_TEXTURE_2D, id);
+	u32 size, flags, fourCC, rgbBitCount;
+	u32 rMask, gMask, bMask, aMask;
+};
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, cachedWrapMode);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, cachedWrapMode);
+struct DDSHeader
+{
+	u32 size, flags, height, width;
+	u32 pitchOrLinearSize, depth, mipMapCount;
+	u32 reserved1[11];
+	DDSPixelFormat pixelFormat;
+	u32 caps, caps2, caps3, caps4, reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	u32 dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+};
+
+enum BlockFormat { BLOCK_BC1, BLOCK_BC3, BLOCK_BC7 };
+
+static bool HasGLExtension(const char* name)
+{
+	i32 extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+
+	for (i32 i = 0; i < extensionCount; i++)
+	{
+		if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+	}
+
+	return false;
 }
 
-void Texture::SetFilterMode(i32 filterMode)
+static bool S3TCSupported()
 {
-	cachedFilterMode = filterMode;
-	glBindTexture(GL_TEXTURE_2D, id);
+	static i32 supported = -1;
+	if (supported == -1) supported = HasGLExtension("GL_EXT_texture_compression_s3tc") ? 1 : 0;
+	return supported == 1;
+}
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, cachedFilterMode);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, cachedFilterMode);
+static void DecodeColor565(u16 color, i32 rgb[3])
+{
+	rgb[0] = ((color >> 11) & 0x1F) * 255 / 31;
+	rgb[1] = ((color >> 5) & 0x3F) * 255 / 63;
+	rgb[2] = (color & 0x1F) * 255 / 31;
 }
 
-static u32 LoadShader(ShaderType type, string filePath)
+//Writes a 4x4 block of RGBA8 texels from an 8 byte BC1 colour block, BC3 colour blocks never use the punch-through mode
+static void DecodeBC1Block(const u8* block, u8* texels, bool alwaysFourColor)
 {
-	string s;
-	string fullPath = string(SHADER_PATH) + filePath;
-	ifstream file(fullPath);
+	u16 color0 = (u16)(block[0] | (block[1] << 8));
+	u16 color1 = (u16)(block[2] | (block[3] << 8));
+	u32 indices = (u32)block[4] | ((u32)block[5] << 8) | ((u32)block[6] << 16) | ((u32)block[7] << 24);
 
-	if (file.fail())
+	i32 palette[4][4];
+	DecodeColor565(color0, palette[0]);
+	DecodeColor565(color1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+	for (u32 c = 0; c < 3; c++)
 	{
-		std::cout << "Failed to make shader! : file not found: " << fullPath << "\n";
-		return -1;
+		if (alwaysFourColor || color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	if (!alwaysFourColor && color0 <= color1) palette[3][3] = 0;
+
+	for (u32 i = 0; i < 16; i++)
+	{
+		const i32* color = palette[(indices >> (i * 2)) & 0x3];
+		for (u32 c = 0; c < 4; c++) texels[i * 4 + c] = (u8)color[c];
+	}
+}
+
+static void DecodeBC3AlphaBlock(const u8* block, u8* texels)
+{
+	i32 alphas[8];
+	alphas[0] = block[0];
+	alphas[1] = block[1];
+
+	if (alphas[0] > alphas[1])
+	{
+		for (i32 i = 1; i < 7; i++) alphas[i + 1] = ((7 - i) * alphas[0] + i * alphas[1]) / 7;
 	}
 	else
 	{
-		//Read into buffer
-		stringstream buffer;
-		buffer << file.rdbuf();
-		s = buffer.str();
+		for (i32 i = 1; i < 5; i++) alphas[i + 1] = ((5 - i) * alphas[0] + i * alphas[1]) / 5;
+		alphas[6] = 0;
+		alphas[7] = 255;
 	}
 
-	const char* source = s.c_str();
+	u64 indices = 0;
+	for (u32 i = 0; i < 6; i++) indices |= (u64)block[2 + i] << (i * 8);
 
-	u32 id = glCreateShader(type == VERTEX ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
-	glShaderSource(id, 1, &source, nullptr);
-	glCompileShader(id);
+	for (u32 i = 0; i < 16; i++)
+	{
+		texels[i * 4 + 3] = (u8)alphas[(indices >> (i * 3)) & 0x7];
+	}
+}
 
-	//Log if we failed
-	i32 success;
-	glGetShaderiv(id, GL_COMPILE_STATUS, &success);
-	if (success == GL_FALSE)
+//Software fallback for drivers without S3TC, only BC1 and BC3 are handled since BC7 is core in GL 4.2
+static void DecodeBlocks(BlockFormat format, const u8* blocks, u32 width, u32 height, u8* pixels)
+{
+	u32 blockBytes = format == BLOCK_BC1 ? 8 : 16;
+	u32 blocksX = (width + 3) / 4;
+	u32 blocksY = (height + 3) / 4;
+
+	for (u32 by = 0; by < blocksY; by++)
 	{
-		char info[512];
-		glGetShaderInfoLog(id, 512, nullptr, info);
-		std::cout << "Failed to make shader! : error in file @" << fullPath << "\n" << info << "\n";
-		return -1;
+		for (u32 bx = 0; bx < blocksX; bx++)
+		{
+			const u8* block = blocks + (by * blocksX + bx) * blockBytes;
+			u8 texels[16 * 4];
+
+			if (format == BLOCK_BC1)
+			{
+				DecodeBC1Block(block, texels, false);
+			}
+			else
+			{
+				DecodeBC1Block(block + 8, texels, true);
+				DecodeBC3AlphaBlock(block, texels);
+			}
+
+			//Copy the parts of the block that land inside the image
+			for (u32 y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				for (u32 x = 0; x < 4 && bx * 4 + x < width; x++)
+				{
+					memcpy(pixels + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
 	}
+}
 
-	std::cout << "Shader created : @" << fullPath << "\n";
-	return id;
+//Creates a texture from the contents of a .dds file, returns false if the file isn't a supported format
+//Bytes in one level of a block compressed image, blocks are 4x4 texels
+static u64 DDSLevelSize(u32 width, u32 height, u32 blockBytes)
+{
+	return (((u64)width + 3) / 4) * (((u64)height + 3) / 4) * blockBytes;
 }
 
-Shader* LoadShader(std::string vertexFilenameAndPath, std::string fragFilenameAndPath)
+static bool CreateTextureFromDDS(Texture& texture, const u8* data, size_t size, const string& fullPath)
 {
 #ifdef TRACY_ENABLE
 	ZoneScoped;
 #endif
 
-	//We add the file addresses together to form the key
-	std::string key = vertexFilenameAndPath + fragFilenameAndPath;
-	if (shaders.find(key) != shaders.end())
+	if (size < 4 + sizeof(DDSHeader) || *(const u32*)data != DDS_MAGIC)
 	{
-		//Return pointer to existing texture
-		return &shaders[key];
+		std::cout << "Image load failed! : not a DDS file @" << fullPath << "\n";
+		return false;
 	}
 
-	Shader shader;
-	shader.uniforms = 0;
-	shader.id = glCreateProgram();
-	glAttachShader(shader.id, LoadShader(VERTEX, vertexFilenameAndPath));
-	glAttachShader(shader.id, LoadShader(FRAGMENT, fragFilenameAndPath));
-	glLinkProgram(shader.id);
+	const DDSHeader* header = (const DDSHeader*)(data + 4);
+	size_t dataOffset = 4 + sizeof(DDSHeader);
 
-	GLint success;
-	glGetProgramiv(shader.id, GL_LINK_STATUS, &success);
+	BlockFormat format;
+	u32 fourCC = (header->pixelFormat.flags & DDS_PIXEL_FORMAT_FOURCC) ? header->pixelFormat.fourCC : 0;
 
-	if (success == GL_FALSE)
+	if (fourCC == DDS_FOURCC('D', 'X', '1', '0'))
 	{
-		char info[512];
-		glGetProgramInfoLog(shader.id, 512, nullptr, info);
-		std::cout << "Failed to make shader program! : linking failed: " << info << "\n";
-
-		return nullptr;
+		if (size < dataOffset + sizeof(DDSHeaderDX10))
+		{
+			std::cout << "Image load failed! : DDS file ends inside its DX10 header @" << fullPath << "\n";
+			return false;
+		}
+
+		const DDSHeaderDX10* dx10 = (const DDSHeaderDX10*)(data + dataOffset);
+		dataOffset += sizeof(DDSHeaderDX10);
+
+		switch (dx10->dxgiFormat)
+		{
+		case DXGI_FORMAT_BC1_UNORM: format = BLOCK_BC1; break;
+		case DXGI_FORMAT_BC3_UNORM: format = BLOCK_BC3; break;
+		case DXGI_FORMAT_BC7_UNORM: format = BLOCK_BC7; break;
+		default:
+			std::cout << "Image load failed! : unsupported DXGI format " << dx10->dxgiFormat << " @" << fullPath << "\n";
+			return false;
+		}
+	}
+	else if (fourCC == DDS_FOURCC('D', 'X', 'T', '1')) format = BLOCK_BC1;
+	else if (fourCC == DDS_FOURCC('D', 'X', 'T', '5')) format = BLOCK_BC3;
+	else
+	{
+		std::cout << "Image load failed! : only BC1, BC3 and BC7 DDS files are supported @" << fullPath << "\n";
+		return false;
 	}
 
-	std::cout << "Shader program created : @" << vertexFilenameAndPath << " + " << fragFilenameAndPath << "\n";
+	GLenum glFormat = format == BLOCK_BC1 ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+		: format == BLOCK_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+		: GL_COMPRESSED_RGBA_BPTC_UNORM;
+	bool decode = format != BLOCK_BC7 && !S3TCSupported();
+	u32 blockBytes = format == BLOCK_BC1 ? 8 : 16;
+	u32 mipCount = std::max(header->mipMapCount, 1u);
 
-	shaders[key] = shader;
-	return &shaders[key];
-}
+	//Checked before the texture is touched, so a bad file, or one caught half written by a hot reload, leaves the old
+	//texture as it was
+	if (header->width == 0 || header->height == 0)
+	{
+		std::cout << "Image load failed! : DDS file is " << header->width << "x" << header->height << " @" << fullPath << "\n";
+		return false;
+	}
 
-void Shader::EnableUniform(u32 uniformID, const char* name)
-{
-#ifdef TRACY_ENABLE
-	ZoneScoped;
-#endif
+	if (DDSLevelSize(header->width, header->height, blockBytes) > size - dataOffset)
+	{
+		std::cout << "Image load failed! : DDS file is truncated @" << fullPath << "\n";
+		return false;
+	}
 
-	u32 location = glGetUniformLocation(id, name);
-	assert(location != -1);
-	uniformLocations[uniformID] = location;
-	uniforms |= uniformID;
-}
+	if (texture.id == 0) glGenTextures(1, &texture.id);
+	BindTexture(texture.id);
 
-void Shader::EnableUniforms(u32 uniformMask)
-{
-#ifdef TRACY_ENABLE
-	ZoneScoped;
-#endif
+	//Set parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.cachedWrapMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.cachedWrapMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.cachedFilterMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilterFor(texture.cachedFilterMode));
 
-	uniforms = uniformMask;
+	texture.size = vec2(header->width, header->height);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	if (HasUniform(SHADER_COLOR)) EnableUniform(SHADER_COLOR, "color");
-	if (HasUniform(SHADER_MAIN_TEX)) EnableUniform(SHADER_MAIN_TEX, "main_tex");
-	if (HasUniform(SHADER_SPEC_POW)) EnableUniform(SHADER_SPEC_POW, "spec_pow");
-}
+	std::vector<u8> decoded;
+	u32 width = header->width;
+	u32 height = header->height;
+	u32 level = 0;
+	texture.memorySize = 0;
 
-bool Shader::HasUniform(u32 uniform)
-{
-	return (uniforms & uniform) == uniform;
-}
+	for (; level < mipCount; level++)
+	{
+		size_t levelSize = (size_t)DDSLevelSize(width, height, blockBytes);
+		if (levelSize > size - dataOffset) break;
+
+		if (decode)
+		{
+			decoded.resize((size_t)width * height * 4);
+			DecodeBlocks(format, data + dataOffset, width, height, decoded.data());
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded.data());
+			texture.memorySize += decoded.size();
+		}
+		else
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, glFormat, width, height, 0, (GLsizei)levelSize, data + dataOffset);
+			texture.memorySize += levelSize;
+		}
+
+		dataOffset += levelSize;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
 
-void Shader::SetUniformInt(u32 uniform, int i)
-{
-	SetActiveShader(this);
-	glUniform1i(uniformLocations[uniform], i);
-}
+	//Only sample the levels the file had, that keeps a single level file complete under mipmapped filtering
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (i32)std::max(level, 1u) - 1);
 
-void Shader::SetUniformFloat(u32 uniform, float f)
-{
-	SetActiveShader(this);
-	glUniform1f(uniformLocations[uniform], f);
+	std::cout << "Texture created : @" << fullPath << (decode ? " (decoded, no S3TC support)\n" : " (compressed)\n");
+	return true;
 }
 
-void Shader::SetUniformVec2(u32 uniform, vec2 v2)
+static bool IsDDSPath(const std::string& path)
 {
-	SetActiveShader(this);
-	glUniform2f(uniformLocations[uniform], v2.x, v2.y);
+	return path.size() >= 4 && (path.compare(path.size() - 4, 4, ".dds") == 0 || path.compare(path.size() - 4, 4, ".DDS") == 0);
 }
 
-void Shader::SetUniformVec3(u32 uniform, vec3 v3)
+static bool ReadFileBytes(const string& path, std::vector<u8>& bytes)
 {
-	SetActiveShader(this);
-	glUniform3f(uniformLocations[uniform], v3.x, v3.y, v3.z);
-}
+	ifstream file(path, std::ios::binary);
+	if (file.fail()) return false;
 
-void Shader::SetUniformVec4(u32 uniform, vec4 v4)
-{
-	SetActiveShader(this);
-	glUniform4f(uniformLocations[uniform], v4.x, v4.y, v4.z, v4.w);
+	bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
 }
 
-Font* LoadFont(std::string filenameAndPath, u32 pixelHeight)
+Texture* LoadTexture(std::string filenameAndPath)
 {
 #ifdef TRACY_ENABLE
 	ZoneScoped;
 #endif
 
-	std::string fontKey = filenameAndPath + "(" + std::to_string(pixelHeight) + "px)";
-	auto it = fonts.find(fontKey);
-	if (it != fonts.end())
+	if (textures.find(filenameAndPath) != textures.end())
 	{
-		//Return pointer to existing font
-		return &it->second;
+		//Return pointer to existing texture
+		return &textures[filenameAndPath];
 	}
 
-	std::string fullPath = std::string(FONT_PATH) + filenameAndPath;
+	//Default wrap and filter modes
+	Texture texture;
 
-	//Load .ttf file
-	//TODO: Currently this crashes if file not found! Pls fix okay thankyou
-	long size;
-	unsigned char* fontBuffer;
-	FILE* fontFile = fopen(fullPath.c_str(), "rb"); //Open file
-	fseek(fontFile, 0, SEEK_END); //Seek to end
-	size = ftell(fontFile); //Get length
-	fseek(fontFile, 0, SEEK_SET); //Seek back to start
-	fontBuffer = new unsigned char[(size_t)size]; //Allocate buffer
-	fread(fontBuffer, (size_t)size, 1, fontFile); //Read file into buffer
-	fclose(fontFile); //Close file
-
-	//Create font
-	stbtt_fontinfo fontInfo;
-	if (stbtt_InitFont(&fontInfo, fontBuffer, 0) == 0)
+	texture.cachedWrapMode = GL_REPEAT;
+	texture.cachedFilterMode = GL_LINEAR_MIPMAP_LINEAR;
+
+	const BingusPackEntry* entry = FindPackEntry(BINGUS_PACK_TEXTURE, filenameAndPath);
+	if (entry != nullptr)
 	{
-		std::cout << "Loading font @" << fullPath << " failed!\n";
-		delete[] fontBuffer;
-		return nullptr;
+		CreateTextureFromPack(texture, entry);
+		textures[filenameAndPath] = texture;
+		return &textures[filenameAndPath];
 	}
 
-	stbtt_pack_context packContext;
-
-	const u32 unicodeCharStart = 32;
-	const u32 unicodeCharEnd = 127;
-	const u32 unicodeCharRange = unicodeCharEnd - unicodeCharStart;
-
-	const u32 atlasWidth = 1024;
-	const u32 atlasHeight = 1024;
-	const u32 atlasSize = atlasWidth * atlasHeight;
-	stbtt_packedchar packedChars[unicodeCharRange];
-	unsigned char* pixelBuffer = new unsigned char[atlasSize];
+	string full_path = string(TEXTURE_PATH) + filenameAndPath;
+	WatchResourceFile(full_path, WATCHED_TEXTURE, filenameAndPath);
 
-	if (stbtt_PackBegin(&packContext, pixelBuffer, atlasWidth, atlasHeight, 0, 1, 0) == 0)
+	if (IsDDSPath(filenameAndPath))
 	{
-		std::cout << "Packing font @" << fullPath << " failed!\n";
-		delete[] fontBuffer;
-		delete[] pixelBuffer;
-		return nullptr;
+		std::vector<u8> fileData;
+		if (!ReadFileBytes(full_path, fileData) || !CreateTextureFromDDS(texture, fileData.data(), fileData.size(), full_path))
+		{
+			std::cout << "Image load failed! : @" << full_path << "\n";
+			texture.id = 0;
+			texture.size = vec2(1);
+		}
+
+		textures[filenameAndPath] = texture;
+		return &textures[filenameAndPath];
 	}
 
-	stbtt_PackSetOversampling(&packContext, 2, 2);
-	stbtt_PackFontRange(&packContext, fontBuffer, 0, (float)pixelHeight, unicodeCharStart, unicodeCharRange, packedChars);
-	stbtt_PackEnd(&packContext);
+	//Load texture from file
+	int width, height, nrChannels;
+	stbi_set_flip_vertically_on_load(true);
 
-	//Create atlas texture
-	u32 textureID;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); //disable byte-alignment restriction
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixelBuffer);
+	unsigned char* textureData = stbi_load(full_path.c_str(), &width, &height, &nrChannels, 0);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	CreateTexture(texture, textureData, width, height, nrChannels, full_path);
+	if (textureData) stbi_image_free(textureData);
 
-	Font font;
-	font.lineHeight = pixelHeight;
-	font.texture.id = textureID;
-	font.texture.size = vec2(atlasWidth, atlasHeight);
-	font.texture.cachedWrapMode = GL_CLAMP_TO_EDGE;
-	font.texture.cachedFilterMode = GL_LINEAR;
+	textures[filenameAndPath] = texture;
+	return &textures[filenameAndPath];
+}
 
-	for (i32 c = unicodeCharStart; c < unicodeCharEnd; c++)
+void Texture::SetWrapMode(i32 wrapMode)
+{
+	if (wrapMode == cachedWrapMode)
 	{
-		const stbtt_packedchar& packedChar = packedChars[c - unicodeCharStart];
-
-		//Create character and store in map
-		FontCharacter character;
-		character.uvMin = vec2((float)packedChar.x0 / (float)atlasWidth, (float)packedChar.y0 / (float)atlasHeight);
-		character.uvMax = vec2((float)packedChar.x1 / (float)atlasWidth, (float)packedChar.y1 / (float)atlasHeight);
-		character.size = vec2(packedChar.xoff2 - packedChar.xoff, packedChar.yoff2 - packedChar.yoff) / (float)pixelHeight;
-		character.bearing = vec2(packedChar.xoff, 1.f - packedChar.yoff) / (float)pixelHeight;
-		character.advance = packedChar.xadvance / (float)pixelHeight;
-
-		font.characters.insert(std::pair<i32, FontCharacter>(c, character));
+		glCallStats.stateChangesSkipped++;
+		return;
 	}
 
-	std::cout << "Successfully loaded font : @" << fullPath << "\n";
+	cachedWrapMode = wrapMode;
+	if (loading) return; //Applied once the texture is uploaded, the placeholder is shared
+	BindTexture(id);
 
-	delete[] fontBuffer;
-	delete[] pixelBuffer;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, cachedWrapMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, cachedWrapMode);
+	glCallStats.stateChanges++;
+}
+
+void Texture::SetFilterMode(i32 filterMode)
+{
+	if (filterMode == cachedFilterMode)
+	{
+		glCallStats.stateChangesSkipped++;
+		return;
+	}
+
+	cachedFilterMode = filterMode;
+	if (loading) return; //Applied once the texture is uploaded, the placeholder is shared
+	BindTexture(id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, cachedFilterMode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilterFor(cachedFilterMode));
+	glCallStats.stateChanges++;
+}
+
+//Sprite atlases, loose images packed into one texture
+static std::unordered_map<std::string, SpriteSheet> spriteAtlases;
+
+struct AtlasImage
+{
+	std::string name; //Path without the extension
+	std::string sequenceName;
+	i32 frameIndex; //-1 for images that aren't part of a numbered run
+	const u8* pixels;
+	unsigned char* ownedPixels; //Freed with stbi_image_free, null for pack entries
+	i32 width, height;
+};
+
+//"walk_2.png" may be frame 2 of the "walk" sequence, whether it is depends on the other files, see ResolveAtlasRuns.
+//Anything else is a sequence of one frame named after the file
+static void GetAtlasSequenceName(const std::string& filenameAndPath, std::string& name, std::string& sequenceName, i32& frameIndex)
+{
+	size_t extension = filenameAndPath.find_last_of('.');
+	size_t directory = filenameAndPath.find_last_of("/\\");
+	if (extension == std::string::npos || (directory != std::string::npos && extension < directory)) extension = filenameAndPath.size();
+
+	name = filenameAndPath.substr(0, extension);
+	sequenceName = name;
+	frameIndex = -1;
+
+	size_t underscore = sequenceName.find_last_of('_');
+	if (underscore == std::string::npos || underscore + 1 == sequenceName.size()) return;
+	if (directory != std::string::npos && underscore < directory) return;
+
+	//Longer numbers are dates or ids, not frames
+	if (sequenceName.size() - underscore - 1 > SPRITE_ATLAS_MAX_FRAME_DIGITS) return;
+
+	for (size_t i = underscore + 1; i < sequenceName.size(); i++)
+	{
+		if (sequenceName[i] < '0' || sequenceName[i] > '9') return;
+	}
+
+	frameIndex = atoi(sequenceName.c_str() + underscore + 1);
+	sequenceName.resize(underscore);
+}
+
+//Only a base name shared by several numbered files is a run, a lone "icon_2.png" stays a sequence called "icon_2".
+//Runs are renumbered from their lowest number, so "walk_1.png", "walk_2.png" are frames 0 and 1. Runs with numbers
+//missing are dropped here, before their frame numbers size anything
+static void ResolveAtlasRuns(const std::string& atlasName, std::vector<AtlasImage>& images)
+{
+	struct AtlasRun
+	{
+		i32 first = INT32_MAX;
+		i32 last = -1;
+		u32 count = 0;
+	};
+
+	std::unordered_map<std::string, AtlasRun> runs;
+	for (const AtlasImage& image : images)
+	{
+		if (image.frameIndex < 0) continue;
+
+		AtlasRun& run = runs[image.sequenceName];
+		run.first = std::min(run.first, image.frameIndex);
+		run.last = std::max(run.last, image.frameIndex);
+		run.count++;
+	}
+
+	for (auto& pair : runs)
+	{
+		const AtlasRun& run = pair.second;
+		if (run.count < 2 || (u32)(run.last - run.first) < run.count) continue;
+
+		std::cout << "Sprite atlas sequence failed to load! : " << atlasName << " \"" << pair.first
+			<< "\" has " << run.count << " frames numbered " << run.first << " to " << run.last << "\n";
+	}
+
+	size_t kept = 0;
+	for (AtlasImage& image : images)
+	{
+		if (image.frameIndex >= 0)
+		{
+			const AtlasRun& run = runs[image.sequenceName];
+			if (run.count < 2)
+			{
+				image.sequenceName = image.name;
+				image.frameIndex = -1;
+			}
+			else if ((u32)(run.last - run.first) >= run.count)
+			{
+				if (image.ownedPixels) stbi_image_free(image.ownedPixels);
+				continue;
+			}
+			else image.frameIndex -= run.first;
+		}
+
+		images[kept++] = image;
+	}
+
+	images.resize(kept);
+}
+
+SpriteSheet* LoadSpriteAtlas(std::string atlasName, const std::vector<std::string>& filenamesAndPaths, u32 padding)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	auto existing = spriteAtlases.find(atlasName);
+	if (existing != spriteAtlases.end())
+	{
+		//Return pointer to existing atlas
+		return &existing->second;
+	}
+
+	//Decode everything to RGBA first, the packer needs all the sizes up front
+	std::vector<AtlasImage> images;
+	images.reserve(filenamesAndPaths.size());
+	stbi_set_flip_vertically_on_load(true);
+
+	for (const std::string& filenameAndPath : filenamesAndPaths)
+	{
+		AtlasImage image;
+		GetAtlasSequenceName(filenameAndPath, image.name, image.sequenceName, image.frameIndex);
+		image.ownedPixels = nullptr;
+
+		const BingusPackEntry* entry = FindPackEntry(BINGUS_PACK_TEXTURE, filenameAndPath);
+		if (entry != nullptr)
+		{
+			//Top mip of a packed texture is already flipped RGBA8
+			image.pixels = packData + entry->offset;
+			image.width = (i32)entry->width;
+			image.height = (i32)entry->height;
+		}
+		else
+		{
+			string fullPath = string(TEXTURE_PATH) + filenameAndPath;
+			if (IsDDSPath(filenameAndPath))
+			{
+				std::cout << "Atlas image skipped! : block compressed images can't be packed @" << fullPath << "\n";
+				continue;
+			}
+
+			i32 channels;
+			image.ownedPixels = stbi_load(fullPath.c_str(), &image.width, &image.height, &channels, 4);
+			if (image.ownedPixels == nullptr)
+			{
+				std::cout << "Image load failed! : @" << fullPath << "\n";
+				continue;
+			}
+
+			image.pixels = image.ownedPixels;
+		}
+
+		images.push_back(image);
+	}
+
+	ResolveAtlasRuns(atlasName, images);
+
+	//Try power of two sizes until everything fits
+	std::vector<stbrp_rect> rects(images.size());
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		rects[i].id = (i32)i;
+		rects[i].w = (stbrp_coord)(images[i].width + padding * 2);
+		rects[i].h = (stbrp_coord)(images[i].height + padding * 2);
+	}
+
+	i32 maxSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	maxSize = std::min(maxSize, SPRITE_ATLAS_MAX_SIZE);
+
+	i32 atlasSize = SPRITE_ATLAS_MIN_SIZE;
+	std::vector<stbrp_node> nodes;
+
+	while (true)
+	{
+		stbrp_context context;
+		nodes.resize(atlasSize);
+		stbrp_init_target(&context, atlasSize, atlasSize, nodes.data(), atlasSize);
+		if (stbrp_pack_rects(&context, rects.data(), (i32)rects.size())) break;
+
+		if (atlasSize * 2 > maxSize)
+		{
+			std::cout << "Failed to build sprite atlas! : images don't fit in " << maxSize << "x" << maxSize << " @" << atlasName << "\n";
+			for (AtlasImage& image : images) if (image.ownedPixels) stbi_image_free(image.ownedPixels);
+			return nullptr;
+		}
+
+		atlasSize *= 2;
+	}
+
+	//Copy the images in, repeating their edge pixels out into the padding so filtering doesn't pull in neighbours
+	std::vector<u8> atlasPixels((size_t)atlasSize * atlasSize * 4, 0);
+	SpriteSheet sheet;
+	std::unordered_map<std::string, std::vector<bool>> framesFilled;
+
+	for (const stbrp_rect& rect : rects)
+	{
+		const AtlasImage& image = images[rect.id];
+		i32 originX = rect.x + (i32)padding;
+		i32 originY = rect.y + (i32)padding;
+
+		for (i32 y = -(i32)padding; y < image.height + (i32)padding; y++)
+		{
+			i32 sourceY = std::clamp(y, 0, image.height - 1);
+			for (i32 x = -(i32)padding; x < image.width + (i32)padding; x++)
+			{
+				i32 sourceX = std::clamp(x, 0, image.width - 1);
+				memcpy(&atlasPixels[((size_t)(originY + y) * atlasSize + originX + x) * 4],
+					&image.pixels[((size_t)sourceY * image.width + sourceX) * 4], 4);
+			}
+		}
+
+		SpriteSequenceFrame frame(Edges::Zero(), Rect(vec2(originX, originY), vec2(originX + image.width, originY + image.height)));
+		std::vector<SpriteSequenceFrame>& frames = sheet.sequences[image.sequenceName].frames;
+		u32 frameIndex = image.frameIndex < 0 ? (u32)frames.size() : (u32)image.frameIndex;
+
+		//Numbered frames go in by number, whatever order the files were listed in
+		if (frameIndex >= frames.size()) frames.resize(frameIndex + 1, frame);
+		else frames[frameIndex] = frame;
+
+		std::vector<bool>& filled = framesFilled[image.sequenceName];
+		if (frameIndex >= filled.size()) filled.resize(frameIndex + 1, false);
+		filled[frameIndex] = true;
+	}
+
+	//Runs with gaps are gone already, bar one hidden by two files sharing a number like "walk_1" and "walk_01". Showing
+	//a neighbouring frame in the gap would hide that
+	for (auto& pair : framesFilled)
+	{
+		auto missing = std::find(pair.second.begin(), pair.second.end(), false);
+		if (missing == pair.second.end()) continue;
+
+		std::cout << "Sprite atlas sequence failed to load! : " << atlasName << " \"" << pair.first
+			<< "\" is missing frame " << (missing - pair.second.begin()) << "\n";
+		sheet.sequences.erase(pair.first);
+	}
+
+	for (AtlasImage& image : images) if (image.ownedPixels) stbi_image_free(image.ownedPixels);
+
+	Texture texture;
+	texture.cachedWrapMode = GL_CLAMP_TO_EDGE;
+	texture.cachedFilterMode = GL_LINEAR_MIPMAP_LINEAR;
+	CreateTexture(texture, atlasPixels.data(), atlasSize, atlasSize, 4, atlasName);
+
+	//Lives with the other textures so it shows up in memory stats, the name can't collide with a file under res
+	string textureKey = "atlas:" + atlasName;
+	textures[textureKey] = texture;
+	sheet.texture = &textures[textureKey];
+
+	std::cout << "Sprite atlas created : @" << atlasName << " (" << images.size() << " images, " << atlasSize << "x" << atlasSize << ")\n";
+
+	spriteAtlases[atlasName] = sheet;
+	return &spriteAtlases[atlasName];
+}
+
+struct ShaderSource
+{
+	const char* data;
+	i32 length;
+	string storage;
+	string fullPath;
+	bool fromPack = false;
+};
+
+static bool ReadShaderSource(const string& filePath, ShaderSource& source)
+{
+	source.fullPath = string(SHADER_PATH) + filePath;
+
+	const BingusPackEntry* entry = FindPackEntry(BINGUS_PACK_SHADER, filePath);
+	if (entry != nullptr)
+	{
+		//Compile straight from the mapped pack
+		source.data = (const char*)(packData + entry->offset);
+		source.length = (i32)entry->size;
+		source.fromPack = true;
+		return true;
+	}
+
+	ifstream file(source.fullPath);
+
+	if (file.fail())
+	{
+		std::cout << "Failed to make shader! : file not found: " << source.fullPath << "\n";
+		return false;
+	}
+
+	//Read into buffer
+	stringstream buffer;
+	buffer << file.rdbuf();
+	source.storage = buffer.str();
+	source.data = source.storage.c_str();
+	source.length = (i32)source.storage.size();
+	return true;
+}
+
+static u32 CompileShader(ShaderType type, const ShaderSource& source)
+{
+	u32 id = glCreateShader(type == VERTEX ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
+	glShaderSource(id, 1, &source.data, &source.length);
+	glCompileShader(id);
+
+	//Log if we failed
+	i32 success;
+	glGetShaderiv(id, GL_COMPILE_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		char info[512];
+		glGetShaderInfoLog(id, 512, nullptr, info);
+		std::cout << "Failed to make shader! : error in file @" << source.fullPath << "\n" << info << "\n";
+		return -1;
+	}
+
+	std::cout << "Shader created : @" << source.fullPath << "\n";
+	return id;
+}
+
+//Program binary cache, linked programs are saved per source and driver so later launches can skip compiling
+#define PROGRAM_CACHE_PATH "../shader_cache/"
+#define PROGRAM_CACHE_MAGIC 0x43534742 //"BGSC"
+
+struct ProgramCacheHeader
+{
+	u32 magic;
+	u32 binaryFormat;
+	u32 binaryLength;
+};
+
+static void HashBytes(u64& hash, const char* data, size_t length)
+{
+	//FNV-1a
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (u8)data[i];
+		hash *= 0x100000001B3ull;
+	}
+
+	hash ^= 0xFF;
+	hash *= 0x100000001B3ull;
+}
+
+static bool ProgramBinariesSupported()
+{
+	static i32 formatCount = -1;
+	if (formatCount == -1) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+//Binaries are only valid for the driver that made them, so the renderer and version strings go in the key too
+static string GetProgramCachePath(const ShaderSource& vertexSource, const ShaderSource& fragmentSource)
+{
+	u64 hash = 0xCBF29CE484222325ull;
+	HashBytes(hash, vertexSource.data, (size_t)vertexSource.length);
+	HashBytes(hash, fragmentSource.data, (size_t)fragmentSource.length);
+
+	GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : driverStrings)
+	{
+		const char* value = (const char*)glGetString(name);
+		if (value != nullptr) HashBytes(hash, value, strlen(value));
+	}
+
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "%016llx.bin", (unsigned long long)hash);
+	return string(PROGRAM_CACHE_PATH) + fileName;
+}
+
+//Returns 0 if there is no usable binary, the driver is free to reject one after an update
+static u32 LoadCachedProgram(const string& cachePath)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	if (!ProgramBinariesSupported()) return 0;
+
+	ifstream file(cachePath, std::ios::binary);
+	if (file.fail()) return 0;
+
+	ProgramCacheHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || header.magic != PROGRAM_CACHE_MAGIC) return 0;
+
+	std::vector<char> binary(header.binaryLength);
+	file.read(binary.data(), header.binaryLength);
+	if (!file) return 0;
+
+	u32 id = glCreateProgram();
+	glProgramBinary(id, header.binaryFormat, binary.data(), (GLsizei)header.binaryLength);
+
+	GLint success;
+	glGetProgramiv(id, GL_LINK_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		DeleteProgram(id);
+		return 0;
+	}
+
+	return id;
+}
+
+static void SaveCachedProgram(u32 id, const string& cachePath)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	if (!ProgramBinariesSupported()) return;
+
+	GLint length = 0;
+	glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	ProgramCacheHeader header;
+	std::vector<char> binary((size_t)length);
+	glGetProgramBinary(id, length, nullptr, &header.binaryFormat, binary.data());
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.binaryLength = (u32)length;
+
+	std::error_code error;
+	std::filesystem::create_directories(PROGRAM_CACHE_PATH, error);
+
+	std::ofstream file(cachePath, std::ios::binary);
+	if (file.fail()) return;
+
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), length);
+}
+
+//The files each program was built from, the shaders map is keyed by the two names joined together
+struct ShaderFiles
+{
+	string vertex;
+	string fragment;
+};
+
+static std::unordered_map<std::string, ShaderFiles> shaderFiles;
+
+Shader* LoadShader(std::string vertexFilenameAndPath, std::string fragFilenameAndPath)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	//We add the file addresses together to form the key
+	std::string key = vertexFilenameAndPath + fragFilenameAndPath;
+	if (shaders.find(key) != shaders.end())
+	{
+		//Return pointer to existing texture
+		return &shaders[key];
+	}
+
+	ShaderSource vertexSource, fragmentSource;
+	if (!ReadShaderSource(vertexFilenameAndPath, vertexSource) || !ReadShaderSource(fragFilenameAndPath, fragmentSource))
+	{
+		return nullptr;
+	}
+
+	shaderFiles[key] = { vertexFilenameAndPath, fragFilenameAndPath };
+	if (!vertexSource.fromPack) WatchResourceFile(vertexSource.fullPath, WATCHED_SHADER, vertexFilenameAndPath);
+	if (!fragmentSource.fromPack) WatchResourceFile(fragmentSource.fullPath, WATCHED_SHADER, fragFilenameAndPath);
+
+	Shader shader;
+	shader.uniforms = 0;
+
+	string cachePath = GetProgramCachePath(vertexSource, fragmentSource);
+	shader.id = LoadCachedProgram(cachePath);
+
+	if (shader.id != 0)
+	{
+		std::cout << "Shader program loaded from cache : @" << vertexFilenameAndPath << " + " << fragFilenameAndPath << "\n";
+		shaders[key] = shader;
+		return &shaders[key];
+	}
+
+	shader.id = glCreateProgram();
+	u32 vertexShader = CompileShader(VERTEX, vertexSource);
+	u32 fragmentShader = CompileShader(FRAGMENT, fragmentSource);
+	glAttachShader(shader.id, vertexShader);
+	glAttachShader(shader.id, fragmentShader);
+	if (ProgramBinariesSupported()) glProgramParameteri(shader.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(shader.id);
+
+	GLint success;
+	glGetProgramiv(shader.id, GL_LINK_STATUS, &success);
+
+	if (success == GL_FALSE)
+	{
+		char info[512];
+		glGetProgramInfoLog(shader.id, 512, nullptr, info);
+		std::cout << "Failed to make shader program! : linking failed: " << info << "\n";
+
+		return nullptr;
+	}
+
+	//The program keeps what it needs once linked
+	glDetachShader(shader.id, vertexShader);
+	glDetachShader(shader.id, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	SaveCachedProgram(shader.id, cachePath);
+
+	std::cout << "Shader program created : @" << vertexFilenameAndPath << " + " << fragFilenameAndPath << "\n";
+
+	shaders[key] = shader;
+	return &shaders[key];
+}
+
+void Shader::EnableUniform(u32 uniformID, const char* name)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	i32 location = glGetUniformLocation(id, name);
+	assert(location != -1);
+	uniformLocations[ShaderUniformSlot(uniformID)] = location;
+	uniforms |= uniformID;
+	uniformValuesSet &= ~uniformID;
+}
+
+void Shader::EnableUniforms(u32 uniformMask)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	uniforms = uniformMask;
+	uniformValuesSet = 0; //Linking resets every uniform
+
+	if (HasUniform(SHADER_COLOR)) EnableUniform(SHADER_COLOR, "color");
+	if (HasUniform(SHADER_MAIN_TEX)) EnableUniform(SHADER_MAIN_TEX, "main_tex");
+	if (HasUniform(SHADER_SPEC_POW)) EnableUniform(SHADER_SPEC_POW, "spec_pow");
+}
+
+bool Shader::HasUniform(u32 uniform)
+{
+	return (uniforms & uniform) == uniform;
+}
+
+//Records the value about to be sent, returns false if the uniform already holds it
+static bool UpdateUniformValue(Shader& shader, u32 uniform, const void* value, size_t size)
+{
+	u32* current = shader.uniformValues[ShaderUniformSlot(uniform)];
+
+	if ((shader.uniformValuesSet & uniform) && memcmp(current, value, size) == 0)
+	{
+		glCallStats.uniformSetsSkipped++;
+		return false;
+	}
+
+	memcpy(current, value, size);
+	shader.uniformValuesSet |= uniform;
+	glCallStats.uniformSets++;
+	return true;
+}
+
+//Uniforms are set on the program directly, so setting them doesn't disturb the bound program
+
+void Shader::SetUniformInt(u32 uniform, int i)
+{
+	if (!UpdateUniformValue(*this, uniform, &i, sizeof(i))) return;
+	glProgramUniform1i(id, uniformLocations[ShaderUniformSlot(uniform)], i);
+}
+
+void Shader::SetUniformFloat(u32 uniform, float f)
+{
+	if (!UpdateUniformValue(*this, uniform, &f, sizeof(f))) return;
+	glProgramUniform1f(id, uniformLocations[ShaderUniformSlot(uniform)], f);
+}
+
+void Shader::SetUniformVec2(u32 uniform, vec2 v2)
+{
+	if (!UpdateUniformValue(*this, uniform, &v2, sizeof(v2))) return;
+	glProgramUniform2f(id, uniformLocations[ShaderUniformSlot(uniform)], v2.x, v2.y);
+}
+
+void Shader::SetUniformVec3(u32 uniform, vec3 v3)
+{
+	if (!UpdateUniformValue(*this, uniform, &v3, sizeof(v3))) return;
+	glProgramUniform3f(id, uniformLocations[ShaderUniformSlot(uniform)], v3.x, v3.y, v3.z);
+}
+
+void Shader::SetUniformVec4(u32 uniform, vec4 v4)
+{
+	if (!UpdateUniformValue(*this, uniform, &v4, sizeof(v4))) return;
+	glProgramUniform4f(id, uniformLocations[ShaderUniformSlot(uniform)], v4.x, v4.y, v4.z, v4.w);
+}
+
+struct FontSource
+{
+	unsigned char* buffer;
+	size_t bufferSize;
+	stbtt_fontinfo info;
+	float pixelHeight;
+	bool sdf;
+};
+
+//Shared glyph atlas, pixels are kept on the CPU so only the rectangles touched since the last flush get uploaded
+static stbtt_pack_context glyphAtlasPacker;
+static unsigned char* glyphAtlasPixels = nullptr;
+static Texture glyphAtlasTexture;
+static i32 glyphAtlasDirtyMinX, glyphAtlasDirtyMinY, glyphAtlasDirtyMaxX, glyphAtlasDirtyMaxY;
+static bool glyphAtlasDirty = false;
+static bool glyphAtlasFull = false;
+static u32 glyphAtlasGeneration = 0;
+u32 glyphAtlasFrame = 0;
+
+static void MarkGlyphAtlasDirty(i32 minX, i32 minY, i32 maxX, i32 maxY)
+{
+	if (!glyphAtlasDirty)
+	{
+		glyphAtlasDirtyMinX = minX;
+		glyphAtlasDirtyMinY = minY;
+		glyphAtlasDirtyMaxX = maxX;
+		glyphAtlasDirtyMaxY = maxY;
+		glyphAtlasDirty = true;
+		return;
+	}
+
+	glyphAtlasDirtyMinX = std::min(glyphAtlasDirtyMinX, minX);
+	glyphAtlasDirtyMinY = std::min(glyphAtlasDirtyMinY, minY);
+	glyphAtlasDirtyMaxX = std::max(glyphAtlasDirtyMaxX, maxX);
+	glyphAtlasDirtyMaxY = std::max(glyphAtlasDirtyMaxY, maxY);
+}
+
+static void ResetGlyphAtlasPacker()
+{
+	if (glyphAtlasPixels != nullptr) stbtt_PackEnd(&glyphAtlasPacker);
+	else glyphAtlasPixels = new unsigned char[GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE];
+
+	memset(glyphAtlasPixels, 0, GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE);
+	stbtt_PackBegin(&glyphAtlasPacker, glyphAtlasPixels, GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE, 0, 1, nullptr);
+	stbtt_PackSetOversampling(&glyphAtlasPacker, 2, 2);
+	glyphAtlasFull = false;
+}
+
+static void InitGlyphAtlas()
+{
+	if (glyphAtlasPixels != nullptr) return;
+
+	ResetGlyphAtlasPacker();
+
+	glGenTextures(1, &glyphAtlasTexture.id);
+	BindTexture(glyphAtlasTexture.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); //disable byte-alignment restriction
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, glyphAtlasPixels);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glyphAtlasTexture.size = vec2(GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE);
+	glyphAtlasTexture.cachedWrapMode = GL_CLAMP_TO_EDGE;
+	glyphAtlasTexture.cachedFilterMode = GL_LINEAR;
+}
+
+void FlushGlyphAtlas()
+{
+	if (!glyphAtlasDirty) return;
+
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	i32 width = glyphAtlasDirtyMaxX - glyphAtlasDirtyMinX;
+	i32 height = glyphAtlasDirtyMaxY - glyphAtlasDirtyMinY;
+
+	BindTexture(glyphAtlasTexture.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, GLYPH_ATLAS_SIZE);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, glyphAtlasDirtyMinX, glyphAtlasDirtyMinY, width, height, GL_RED, GL_UNSIGNED_BYTE,
+		glyphAtlasPixels + glyphAtlasDirtyMinY * GLYPH_ATLAS_SIZE + glyphAtlasDirtyMinX);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	glyphAtlasDirty = false;
+}
+
+u32 GetGlyphAtlasGeneration()
+{
+	return glyphAtlasGeneration;
+}
+
+void UpdateGlyphAtlas()
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	glyphAtlasFrame++;
+	if (!glyphAtlasFull) return;
+
+	struct GlyphRef
+	{
+		Font* font;
+		u32 index;
+		u32 lastUsedFrame;
+	};
+
+	//Evict everything, then rasterise glyphs back in from most to least recently used until the atlas is full again
+	std::vector<GlyphRef> residentGlyphs;
+	for (auto& pair : fonts)
+	{
+		Font& font = pair.second;
+		for (u32 i = FONT_GLYPH_REPLACEMENT; i < font.glyphs.size(); i++)
+		{
+			if (!font.glyphs[i].resident) continue;
+
+			font.glyphs[i].resident = false;
+			residentGlyphs.push_back({ &font, i, font.glyphs[i].lastUsedFrame });
+		}
+	}
+
+	std::sort(residentGlyphs.begin(), residentGlyphs.end(), [](const GlyphRef& a, const GlyphRef& b)
+	{
+		return a.lastUsedFrame > b.lastUsedFrame;
+	});
+
+	ResetGlyphAtlasPacker();
+
+	for (const GlyphRef& glyph : residentGlyphs)
+	{
+		if (!glyph.font->RasterizeGlyph(glyph.index)) break;
+	}
+
+	glyphAtlasFull = false;
+	glyphAtlasGeneration++;
+	MarkGlyphAtlasDirty(0, 0, GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE);
+}
+
+Font::Font()
+{
+	lineHeight = 0;
+	source = nullptr;
+	sdf = false;
+	loading = false;
+	extendedCount = 0;
+
+	//Reserve the empty and replacement glyphs
+	FontCharacter empty;
+	empty.uvMin = vec2(0);
+	empty.uvMax = vec2(0);
+	empty.size = vec2(0);
+	empty.bearing = vec2(0);
+	empty.advance = 0.f;
+	empty.codepoint = 0;
+	empty.lastUsedFrame = 0;
+	empty.resident = true;
+	glyphs = std::vector<FontCharacter>(2, empty);
+
+	//The replacement glyph is rasterised on first use like any other
+	glyphs[FONT_GLYPH_REPLACEMENT].codepoint = '?';
+	glyphs[FONT_GLYPH_REPLACEMENT].resident = false;
+
+	for (i32 c = 0; c < FONT_DIRECT_GLYPH_COUNT; c++)
+	{
+		bool control = c < 32 || (c >= 127 && c < 160);
+		directGlyphs[c] = control ? FONT_GLYPH_EMPTY : FONT_GLYPH_NONE;
+	}
+}
+
+void Font::SetGlyphIndex(i32 codepoint, u32 index)
+{
+	assert(codepoint >= 0);
+
+	if (codepoint < FONT_DIRECT_GLYPH_COUNT)
+	{
+		directGlyphs[codepoint] = index;
+		return;
+	}
+
+	//Grow and rehash, keeping the load factor under a half
+	if ((extendedCount + 1) * 2 > extendedCodepoints.size())
+	{
+		std::vector<i32> oldCodepoints = std::move(extendedCodepoints);
+		std::vector<u32> oldGlyphs = std::move(extendedGlyphs);
+		size_t capacity = std::max(oldCodepoints.size() * 2, (size_t)64);
+		extendedCodepoints = std::vector<i32>(capacity, -1);
+		extendedGlyphs = std::vector<u32>(capacity, FONT_GLYPH_NONE);
+
+		u32 mask = (u32)capacity - 1;
+		for (size_t i = 0; i < oldCodepoints.size(); i++)
+		{
+			if (oldCodepoints[i] == -1) continue;
+
+			u32 slot = HashCodepoint(oldCodepoints[i]) & mask;
+			while (extendedCodepoints[slot] != -1) slot = (slot + 1) & mask;
+			extendedCodepoints[slot] = oldCodepoints[i];
+			extendedGlyphs[slot] = oldGlyphs[i];
+		}
+	}
+
+	u32 mask = (u32)extendedCodepoints.size() - 1;
+	u32 slot = HashCodepoint(codepoint) & mask;
+	while (extendedCodepoints[slot] != -1 && extendedCodepoints[slot] != codepoint) slot = (slot + 1) & mask;
+
+	if (extendedCodepoints[slot] != codepoint)
+	{
+		extendedCodepoints[slot] = codepoint;
+		extendedCount++;
+	}
+
+	extendedGlyphs[slot] = index;
+}
+
+void Font::SetReplacementGlyph(i32 codepoint)
+{
+	glyphs[FONT_GLYPH_REPLACEMENT].codepoint = codepoint;
+	glyphs[FONT_GLYPH_REPLACEMENT].resident = false;
+}
+
+bool Font::HasGlyph(i32 codepoint) const
+{
+	u32 index = FindGlyphIndex(codepoint);
+	if (index == FONT_GLYPH_NONE) return source != nullptr && stbtt_FindGlyphIndex(&source->info, codepoint) != 0;
+	return index != FONT_GLYPH_EMPTY && index != FONT_GLYPH_REPLACEMENT;
+}
+
+u32 Font::LoadGlyph(i32 codepoint)
+{
+	//Codepoints the font doesn't cover share the replacement glyph rather than rasterising .notdef again
+	if (codepoint < 0 || source == nullptr || stbtt_FindGlyphIndex(&source->info, codepoint) == 0)
+	{
+		if (codepoint >= 0) SetGlyphIndex(codepoint, FONT_GLYPH_REPLACEMENT);
+		return FONT_GLYPH_REPLACEMENT;
+	}
+
+	FontCharacter character = glyphs[FONT_GLYPH_EMPTY];
+	character.codepoint = codepoint;
+	character.resident = false;
+
+	u32 index = (u32)glyphs.size();
+	glyphs.push_back(character);
+	SetGlyphIndex(codepoint, index);
+	return index;
+}
+
+bool Font::RasterizeGlyph(u32 index)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	if (source == nullptr || glyphAtlasFull) return false;
+	if (source->sdf) return RasterizeGlyphSDF(index);
+
+	FontCharacter& character = glyphs[index];
+
+	stbtt_packedchar packedChar;
+	stbtt_pack_range range = {};
+	range.font_size = source->pixelHeight;
+	range.array_of_unicode_codepoints = &character.codepoint;
+	range.num_chars = 1;
+	range.chardata_for_range = &packedChar;
+
+	stbrp_rect rect;
+	stbtt_PackFontRangesGatherRects(&glyphAtlasPacker, &source->info, &range, 1, &rect);
+	stbtt_PackFontRangesPackRects(&glyphAtlasPacker, &rect, 1);
+
+	if (!rect.was_packed)
+	{
+		//Leave the atlas alone for the rest of the frame, UpdateGlyphAtlas compacts it before the next one
+		glyphAtlasFull = true;
+		return false;
+	}
+
+	stbtt_PackFontRangesRenderIntoRects(&glyphAtlasPacker, &source->info, &range, 1, &rect);
+	if (rect.w != 0 && rect.h != 0) MarkGlyphAtlasDirty(rect.x, rect.y, rect.x + rect.w, rect.y + rect.h);
+
+	float pixelHeight = source->pixelHeight;
+	character.uvMin = vec2((float)packedChar.x0 / (float)GLYPH_ATLAS_SIZE, (float)packedChar.y0 / (float)GLYPH_ATLAS_SIZE);
+	character.uvMax = vec2((float)packedChar.x1 / (float)GLYPH_ATLAS_SIZE, (float)packedChar.y1 / (float)GLYPH_ATLAS_SIZE);
+	character.size = vec2(packedChar.xoff2 - packedChar.xoff, packedChar.yoff2 - packedChar.yoff) / pixelHeight;
+	character.bearing = vec2(packedChar.xoff, 1.f - packedChar.yoff) / pixelHeight;
+	character.advance = packedChar.xadvance / pixelHeight;
+	character.resident = true;
+
+	return true;
+}
+
+bool Font::RasterizeGlyphSDF(u32 index)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	FontCharacter& character = glyphs[index];
+
+	float pixelHeight = source->pixelHeight;
+	float scale = stbtt_ScaleForPixelHeight(&source->info, pixelHeight);
+
+	i32 width, height, xOffset, yOffset;
+	unsigned char* distances = stbtt_GetCodepointSDF(&source->info, scale, character.codepoint, FONT_SDF_PADDING,
+		FONT_SDF_EDGE_VALUE, (float)FONT_SDF_EDGE_VALUE / (float)FONT_SDF_PADDING, &width, &height, &xOffset, &yOffset);
+
+	i32 advance, leftSideBearing;
+	stbtt_GetCodepointHMetrics(&source->info, character.codepoint, &advance, &leftSideBearing);
+
+	character.advance = (float)advance * scale / pixelHeight;
+	character.resident = true;
+
+	//Whitespace has no outline to store
+	if (distances == nullptr)
+	{
+		character.uvMin = vec2(0);
+		character.uvMax = vec2(0);
+		character.size = vec2(0);
+		character.bearing = vec2(0);
+		return true;
+	}
+
+	//Pack through the same rect packer as bitmap glyphs, with a texel of padding so neighbours don't bleed
+	stbrp_rect rect = {};
+	rect.w = (stbrp_coord)(width + 1);
+	rect.h = (stbrp_coord)(height + 1);
+	stbrp_pack_rects((stbrp_context*)glyphAtlasPacker.pack_info, &rect, 1);
+
+	if (!rect.was_packed)
+	{
+		stbtt_FreeSDF(distances, nullptr);
+		character.resident = false;
+		glyphAtlasFull = true;
+		return false;
+	}
+
+	for (i32 y = 0; y < height; y++)
+	{
+		memcpy(glyphAtlasPixels + (rect.y + y) * GLYPH_ATLAS_SIZE + rect.x, distances + y * width, (size_t)width);
+	}
+
+	stbtt_FreeSDF(distances, nullptr);
+	MarkGlyphAtlasDirty(rect.x, rect.y, rect.x + width, rect.y + height);
+
+	character.uvMin = vec2((float)rect.x / (float)GLYPH_ATLAS_SIZE, (float)rect.y / (float)GLYPH_ATLAS_SIZE);
+	character.uvMax = vec2((float)(rect.x + width) / (float)GLYPH_ATLAS_SIZE, (float)(rect.y + height) / (float)GLYPH_ATLAS_SIZE);
+	character.size = vec2((float)width, (float)height) / pixelHeight;
+	character.bearing = vec2((float)xOffset, 1.f - (float)yOffset) / pixelHeight;
+
+	return true;
+}
+
+//Reads a .ttf file, the buffer stays in memory so glyphs can be rasterised on demand. Safe to call off the main thread
+static FontSource* ReadFontSource(const std::string& filenameAndPath, u32 pixelHeight, bool sdf)
+{
+	std::string fullPath = std::string(FONT_PATH) + filenameAndPath;
+	unsigned char* fontBuffer = nullptr;
+	size_t fontBufferSize = 0;
+
+	{
+		//Glyphs are rasterised from the buffer for as long as the font lives, so it's copied rather than left pointing
+		//into a pack that may be unmounted first
+		std::lock_guard<std::mutex> lock(packMutex);
+		const BingusPackEntry* entry = FindPackEntry(BINGUS_PACK_FONT, filenameAndPath);
+		if (entry != nullptr)
+		{
+			fontBufferSize = (size_t)entry->size;
+			fontBuffer = new unsigned char[fontBufferSize];
+			memcpy(fontBuffer, packData + entry->offset, fontBufferSize);
+		}
+	}
+
+	if (fontBuffer == nullptr)
+	{
+		//Load .ttf file
+		long size;
+		FILE* fontFile = fopen(fullPath.c_str(), "rb"); //Open file
+		if (fontFile == nullptr)
+		{
+			std::cout << "Loading font @" << fullPath << " failed! File not found\n";
+			return nullptr;
+		}
+
+		fseek(fontFile, 0, SEEK_END); //Seek to end
+		size = ftell(fontFile); //Get length
+		fseek(fontFile, 0, SEEK_SET); //Seek back to start
+		fontBuffer = new unsigned char[(size_t)size]; //Allocate buffer
+		fread(fontBuffer, (size_t)size, 1, fontFile); //Read file into buffer
+		fclose(fontFile); //Close file
+		fontBufferSize = (size_t)size;
+	}
+
+	FontSource* source = new FontSource();
+	source->buffer = fontBuffer;
+	source->bufferSize = fontBufferSize;
+	source->pixelHeight = (float)pixelHeight;
+	source->sdf = sdf;
+
+	if (stbtt_InitFont(&source->info, fontBuffer, 0) == 0)
+	{
+		std::cout << "Loading font @" << fullPath << " failed!\n";
+		delete[] fontBuffer;
+		delete source;
+		return nullptr;
+	}
+
+	return source;
+}
+
+//Stores a font for the source, replacing any placeholder that was standing in for it
+static Font* StoreFont(const std::string& fontKey, FontSource* source, const std::string& fullPath)
+{
+	InitGlyphAtlas();
+
+	Font font;
+	font.lineHeight = (u32)source->pixelHeight;
+	font.texture = glyphAtlasTexture;
+	font.source = source;
+	font.sdf = source->sdf;
+	font.SetReplacementGlyph('?');
+
+	std::cout << "Successfully loaded font : @" << fullPath << "\n";
+
+	fonts[fontKey] = font;
+	return &fonts[fontKey];
+}
+
+static Font* LoadFontFile(std::string filenameAndPath, std::string fontKey, u32 pixelHeight, bool sdf)
+{
+	std::string fullPath = std::string(FONT_PATH) + filenameAndPath;
+
+	FontSource* source = ReadFontSource(filenameAndPath, pixelHeight, sdf);
+	if (source == nullptr) return nullptr;
+
+	return StoreFont(fontKey, source, fullPath);
+}
+
+Font* LoadFont(std::string filenameAndPath, u32 pixelHeight)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	std::string fontKey = filenameAndPath + "(" + std::to_string(pixelHeight) + "px)";
+	auto it = fonts.find(fontKey);
+	if (it != fonts.end())
+	{
+		//Return pointer to existing font
+		return &it->second;
+	}
+
+	return LoadFontFile(filenameAndPath, fontKey, pixelHeight, false);
+}
+
+Font* LoadFontSDF(std::string filenameAndPath)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	//One distance field font per typeface, it scales to any text size
+	std::string fontKey = filenameAndPath + "(sdf)";
+	auto it = fonts.find(fontKey);
+	if (it != fonts.end())
+	{
+		//Return pointer to existing font
+		return &it->second;
+	}
+
+	return LoadFontFile(filenameAndPath, fontKey, FONT_SDF_PIXEL_HEIGHT, true);
+}
+
+//Async loading
+
+enum ResourceLoadType { LOAD_TEXTURE, LOAD_FONT };
+
+struct ResourceLoadJob
+{
+	ResourceLoadType type;
+	std::string key;
+	std::string name;
+	std::string fullPath;
+
+	//Texture results, DDS files are read whole and uploaded on the main thread
+	unsigned char* data = nullptr;
+	i32 width = 0, height = 0, channels = 0;
+	std::vector<u8> fileData;
+
+	//Font results
+	FontSource* source = nullptr;
+	u32 pixelHeight = 0;
+	bool sdf = false;
+
+	bool reload = false; //Replaces an existing texture in place, see UpdateResourceHotReload
+};
+
+//Worker threads decode files into finishedJobs, the main thread picks them up in UpdateResourceLoading
+struct ResourceLoader
+{
+	std::vector<std::thread> threads;
+	std::deque<ResourceLoadJob> pendingJobs;
+	std::deque<ResourceLoadJob> finishedJobs;
+	std::mutex pendingMutex;
+	std::mutex finishedMutex;
+	std::condition_variable pendingCondition;
+	bool quit = false;
+	u32 jobsInFlight = 0; //Only touched by the main thread
+
+	~ResourceLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			quit = true;
+		}
+
+		pendingCondition.notify_all();
+		for (std::thread& thread : threads) thread.join();
+	}
+};
+
+static ResourceLoader resourceLoader;
+static Texture placeholderTexture;
+static Font* placeholderFont = nullptr;
+
+static void ResourceLoaderThread()
+{
+	stbi_set_flip_vertically_on_load_thread(true);
+
+	while (true)
+	{
+		ResourceLoadJob job;
+
+		{
+			std::unique_lock<std::mutex> lock(resourceLoader.pendingMutex);
+			resourceLoader.pendingCondition.wait(lock, []() { return resourceLoader.quit || !resourceLoader.pendingJobs.empty(); });
+			if (resourceLoader.quit) return;
+
+			job = std::move(resourceLoader.pendingJobs.front());
+			resourceLoader.pendingJobs.pop_front();
+		}
+
+		if (job.type == LOAD_TEXTURE && IsDDSPath(job.fullPath))
+		{
+			ReadFileBytes(job.fullPath, job.fileData);
+		}
+		else if (job.type == LOAD_TEXTURE)
+		{
+			job.data = stbi_load(job.fullPath.c_str(), &job.width, &job.height, &job.channels, 0);
+		}
+		else
+		{
+			job.source = ReadFontSource(job.name, job.pixelHeight, job.sdf);
+		}
+
+		std::lock_guard<std::mutex> lock(resourceLoader.finishedMutex);
+		resourceLoader.finishedJobs.push_back(std::move(job));
+	}
+}
+
+static void SubmitResourceLoadJob(ResourceLoadJob job)
+{
+	if (resourceLoader.threads.empty())
+	{
+		for (u32 i = 0; i < RESOURCE_LOADER_THREADS; i++)
+		{
+			resourceLoader.threads.push_back(std::thread(ResourceLoaderThread));
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(resourceLoader.pendingMutex);
+		resourceLoader.pendingJobs.push_back(std::move(job));
+	}
+
+	resourceLoader.jobsInFlight++;
+	resourceLoader.pendingCondition.notify_one();
+}
+
+//Magenta and black checkerboard so missing art is obvious
+static void InitPlaceholderTexture()
+{
+	if (placeholderTexture.id != 0) return;
+
+	u8 pixels[] = {
+		255, 0, 255, 255,	0, 0, 0, 255,
+		0, 0, 0, 255,		255, 0, 255, 255
+	};
+
+	placeholderTexture.cachedWrapMode = GL_REPEAT;
+	placeholderTexture.cachedFilterMode = GL_NEAREST;
+	CreateTexture(placeholderTexture, pixels, 2, 2, 4, "placeholder");
+}
+
+Texture* LoadTextureAsync(std::string filenameAndPath)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	auto it = textures.find(filenameAndPath);
+	if (it != textures.end())
+	{
+		//Return pointer to existing or loading texture
+		return &it->second;
+	}
+
+	//Packed textures are already decoded, there is nothing to gain from a worker
+	if (FindPackEntry(BINGUS_PACK_TEXTURE, filenameAndPath) != nullptr) return LoadTexture(filenameAndPath);
+
+	InitPlaceholderTexture();
+
+	//Stand in with the placeholder until the upload, wrap and filter modes set in the meantime are kept
+	Texture texture;
+	texture.id = placeholderTexture.id;
+	texture.size = placeholderTexture.size;
+	texture.cachedWrapMode = GL_REPEAT;
+	texture.cachedFilterMode = GL_LINEAR_MIPMAP_LINEAR;
+	texture.loading = true;
+	textures[filenameAndPath] = texture;
+
+	ResourceLoadJob job;
+	job.type = LOAD_TEXTURE;
+	job.key = filenameAndPath;
+	job.fullPath = string(TEXTURE_PATH) + filenameAndPath;
+	WatchResourceFile(job.fullPath, WATCHED_TEXTURE, filenameAndPath);
+	SubmitResourceLoadJob(std::move(job));
+
+	return &textures[filenameAndPath];
+}
+
+static Font* LoadFontFileAsync(std::string filenameAndPath, std::string fontKey, u32 pixelHeight, bool sdf)
+{
+	auto it = fonts.find(fontKey);
+	if (it != fonts.end())
+	{
+		//Return pointer to existing or loading font
+		return &it->second;
+	}
+
+	//Stand in with a copy of the placeholder font, or draw nothing if there isn't one
+	Font font = placeholderFont != nullptr ? *placeholderFont : Font();
+	font.loading = true;
+	fonts[fontKey] = font;
+
+	ResourceLoadJob job;
+	job.type = LOAD_FONT;
+	job.key = fontKey;
+	job.name = filenameAndPath;
+	job.fullPath = std::string(FONT_PATH) + filenameAndPath;
+	job.pixelHeight = pixelHeight;
+	job.sdf = sdf;
+	SubmitResourceLoadJob(std::move(job));
 
-	fonts[fontKey] = font;
 	return &fonts[fontKey];
 }
+
+Font* LoadFontAsync(std::string filenameAndPath, u32 pixelHeight)
+{
+	return LoadFontFileAsync(filenameAndPath, filenameAndPath + "(" + std::to_string(pixelHeight) + "px)", pixelHeight, false);
+}
+
+Font* LoadFontSDFAsync(std::string filenameAndPath)
+{
+	return LoadFontFileAsync(filenameAndPath, filenameAndPath + "(sdf)", FONT_SDF_PIXEL_HEIGHT, true);
+}
+
+void SetPlaceholderFont(Font* font)
+{
+	placeholderFont = font;
+}
+
+u32 GetPendingResourceCount()
+{
+	return resourceLoader.jobsInFlight;
+}
+
+//Uploads a changed file over the texture it was loaded into, a file that fails to decode leaves the old one showing
+static void ReloadTexture(ResourceLoadJob& job)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	//The texture may have been unloaded, or not be uploaded yet, while the file was being decoded
+	auto it = textures.find(job.key);
+	bool replaceable = it != textures.end() && !it->second.loading;
+
+	if (IsDDSPath(job.fullPath))
+	{
+		if (replaceable && !job.fileData.empty())
+		{
+			CreateTextureFromDDS(it->second, job.fileData.data(), job.fileData.size(), job.fullPath);
+		}
+		else if (job.fileData.empty())
+		{
+			std::cout << "Image reload failed! : @" << job.fullPath << "\n";
+		}
+	}
+	else
+	{
+		if (replaceable && job.data)
+		{
+			CreateTexture(it->second, job.data, job.width, job.height, job.channels, job.fullPath);
+		}
+		else if (!job.data)
+		{
+			std::cout << "Image reload failed! : @" << job.fullPath << "\n";
+		}
+
+		if (job.data) stbi_image_free(job.data);
+	}
+}
+
+void UpdateResourceLoading(float budgetMs)
+{
+	if (resourceLoader.jobsInFlight == 0) return;
+
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	auto start = std::chrono::steady_clock::now();
+
+	//Always finish at least one job so loading makes progress however tight the budget
+	while (true)
+	{
+		ResourceLoadJob job;
+
+		{
+			std::lock_guard<std::mutex> lock(resourceLoader.finishedMutex);
+			if (resourceLoader.finishedJobs.empty()) break;
+
+			job = std::move(resourceLoader.finishedJobs.front());
+			resourceLoader.finishedJobs.pop_front();
+		}
+
+		if (job.type == LOAD_TEXTURE && job.reload)
+		{
+			ReloadTexture(job);
+		}
+		else if (job.type == LOAD_TEXTURE)
+		{
+			Texture& texture = textures[job.key];
+			texture.loading = false;
+			texture.id = 0; //Still the placeholder's
+
+			if (IsDDSPath(job.fullPath))
+			{
+				if (!CreateTextureFromDDS(texture, job.fileData.data(), job.fileData.size(), job.fullPath))
+				{
+					//Keep showing the placeholder
+					texture.id = placeholderTexture.id;
+					texture.loading = true;
+				}
+			}
+			else
+			{
+				CreateTexture(texture, job.data, job.width, job.height, job.channels, job.fullPath);
+				if (job.data) stbi_image_free(job.data);
+			}
+		}
+		else if (job.source != nullptr)
+		{
+			StoreFont(job.key, job.source, job.fullPath);
+
+			//Layouts cached against the placeholder glyphs need redoing
+			glyphAtlasGeneration++;
+		}
+		else
+		{
+			//Keep the placeholder, there is nothing better to show
+			fonts[job.key].loading = false;
+		}
+
+		resourceLoader.jobsInFlight--;
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= budgetMs) break;
+	}
+}
+
+//Hot reload, files loaded from the res folder are watched and reloaded in place when they change. On Linux the
+//watching is done with inotify, elsewhere the modification times are polled
+#define HOT_RELOAD_POLL_INTERVAL 1.f
+
+struct WatchedFile
+{
+	WatchedFileType type;
+	std::string name; //The name it was loaded with
+	std::filesystem::file_time_type lastWriteTime;
+};
+
+static std::unordered_map<std::string, WatchedFile> watchedFiles; //By full path
+static bool hotReloadEnabled = false;
+
+#ifdef __linux__
+static int hotReloadFd = -1;
+static std::unordered_map<int, std::string> watchedDirectories; //By watch descriptor
+
+static void WatchDirectory(const std::string& fullPath)
+{
+	//Editors tend to save by writing a new file and renaming it over the old one, which a watch on the file
+	//itself would lose, so the directory is watched instead
+	std::string directory = std::filesystem::path(fullPath).parent_path().string();
+	int wd = inotify_add_watch(hotReloadFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+	if (wd < 0)
+	{
+		std::cout << "Failed to watch directory for hot reload : @" << directory << "\n";
+		return;
+	}
+
+	watchedDirectories[wd] = directory;
+}
+#else
+static std::chrono::steady_clock::time_point hotReloadLastPoll;
+#endif
+
+static void WatchResourceFile(const std::string& fullPath, WatchedFileType type, const std::string& name)
+{
+	if (watchedFiles.find(fullPath) != watchedFiles.end()) return;
+
+	WatchedFile file;
+	file.type = type;
+	file.name = name;
+
+	std::error_code error;
+	file.lastWriteTime = std::filesystem::last_write_time(fullPath, error);
+	watchedFiles[fullPath] = file;
+
+#ifdef __linux__
+	if (hotReloadEnabled) WatchDirectory(fullPath);
+#endif
+}
+
+void EnableResourceHotReload(bool enable)
+{
+	if (enable == hotReloadEnabled) return;
+	hotReloadEnabled = enable;
+
+#ifdef __linux__
+	if (enable)
+	{
+		hotReloadFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (hotReloadFd < 0)
+		{
+			std::cout << "Failed to start resource hot reload! : inotify_init1 failed\n";
+			hotReloadEnabled = false;
+			return;
+		}
+
+		for (auto& [fullPath, file] : watchedFiles) WatchDirectory(fullPath);
+	}
+	else
+	{
+		close(hotReloadFd);
+		hotReloadFd = -1;
+		watchedDirectories.clear();
+	}
+#else
+	if (enable)
+	{
+		//Changes made while disabled are picked up on the next poll
+		hotReloadLastPoll = std::chrono::steady_clock::now();
+	}
+#endif
+}
+
+//Relinks the program in place, so its id and every Shader* stay the same. A file that fails to compile or link
+//leaves the old program running
+static void ReloadShader(const std::string& key, const ShaderFiles& files)
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	auto it = shaders.find(key);
+	if (it == shaders.end()) return;
+
+	Shader& shader = it->second;
+
+	ShaderSource vertexSource, fragmentSource;
+	if (!ReadShaderSource(files.vertex, vertexSource) || !ReadShaderSource(files.fragment, fragmentSource)) return;
+
+	u32 vertexShader = CompileShader(VERTEX, vertexSource);
+	u32 fragmentShader = CompileShader(FRAGMENT, fragmentSource);
+
+	if (vertexShader == (u32)-1 || fragmentShader == (u32)-1)
+	{
+		if (vertexShader != (u32)-1) glDeleteShader(vertexShader);
+		if (fragmentShader != (u32)-1) glDeleteShader(fragmentShader);
+		return;
+	}
+
+	//A failed link would leave the real program without an executable, so try it on a scratch program first
+	u32 scratch = glCreateProgram();
+	glAttachShader(scratch, vertexShader);
+	glAttachShader(scratch, fragmentShader);
+	glLinkProgram(scratch);
+
+	GLint success;
+	glGetProgramiv(scratch, GL_LINK_STATUS, &success);
+
+	if (success == GL_FALSE)
+	{
+		char info[512];
+		glGetProgramInfoLog(scratch, 512, nullptr, info);
+		std::cout << "Failed to reload shader program! : linking failed: " << info << "\n";
+	}
+
+	DeleteProgram(scratch);
+
+	if (success != GL_FALSE)
+	{
+		glAttachShader(shader.id, vertexShader);
+		glAttachShader(shader.id, fragmentShader);
+		if (ProgramBinariesSupported()) glProgramParameteri(shader.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(shader.id);
+		glDetachShader(shader.id, vertexShader);
+		glDetachShader(shader.id, fragmentShader);
+
+		//Uniform locations can move between links
+		shader.EnableUniforms(shader.uniforms);
+		SaveCachedProgram(shader.id, GetProgramCachePath(vertexSource, fragmentSource));
+
+		std::cout << "Shader program reloaded : @" << files.vertex << " + " << files.fragment << "\n";
+	}
+
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+}
+
+static void ReloadResourceFile(const std::string& fullPath)
+{
+	auto it = watchedFiles.find(fullPath);
+	if (it == watchedFiles.end()) return;
+
+	const WatchedFile& file = it->second;
+
+	if (file.type == WATCHED_TEXTURE)
+	{
+		//Decoded on the loader threads like an async load, UpdateResourceLoading uploads it over the old texture
+		ResourceLoadJob job;
+		job.type = LOAD_TEXTURE;
+		job.key = file.name;
+		job.fullPath = fullPath;
+		job.reload = true;
+		SubmitResourceLoadJob(std::move(job));
+	}
+	else
+	{
+		//Every program built from the file
+		for (auto& [key, files] : shaderFiles)
+		{
+			if (files.vertex == file.name || files.fragment == file.name) ReloadShader(key, files);
+		}
+	}
+}
+
+void UpdateResourceHotReload()
+{
+	if (!hotReloadEnabled) return;
+
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	//A save can produce several events, each file is only reloaded once per frame
+	std::vector<std::string> changedPaths;
+
+#ifdef __linux__
+	alignas(inotify_event) char buffer[4096];
+
+	while (true)
+	{
+		ssize_t length = read(hotReloadFd, buffer, sizeof(buffer));
+		if (length <= 0) break;
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = (const inotify_event*)(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			auto directory = watchedDirectories.find(event->wd);
+			if (directory == watchedDirectories.end() || event->len == 0) continue;
+
+			std::string fullPath = directory->second + "/" + event->name;
+			if (std::find(changedPaths.begin(), changedPaths.end(), fullPath) == changedPaths.end())
+			{
+				changedPaths.push_back(fullPath);
+			}
+		}
+	}
+#else
+	auto now = std::chrono::steady_clock::now();
+	std::chrono::duration<float> sinceLastPoll = now - hotReloadLastPoll;
+	if (sinceLastPoll.count() < HOT_RELOAD_POLL_INTERVAL) return;
+
+	hotReloadLastPoll = now;
+
+	for (auto& [fullPath, file] : watchedFiles)
+	{
+		std::error_code error;
+		std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(fullPath, error);
+		if (error || writeTime == file.lastWriteTime) continue;
+
+		file.lastWriteTime = writeTime;
+		changedPaths.push_back(fullPath);
+	}
+#endif
+
+	for (const std::string& fullPath : changedPaths) ReloadResourceFile(fullPath);
+}
+
+//Handles, slots remember which key they point at and their generation is bumped when the resource is unloaded,
+//so old handles resolve to nullptr instead of a dangling pointer
+
+struct ResourceSlot
+{
+	std::string key;
+	u32 generation = 1;
+	u32 refCount = 0;
+	u32 lastUsedFrame = 0;
+	bool alive = false;
+};
+
+struct ResourceSlotTable
+{
+	std::vector<ResourceSlot> slots;
+	std::vector<u32> freeSlots;
+	std::unordered_map<std::string, u32> slotIndices;
+
+	u32 Acquire(const std::string& key)
+	{
+		auto it = slotIndices.find(key);
+		if (it != slotIndices.end())
+		{
+			slots[it->second].refCount++;
+			return it->second;
+		}
+
+		u32 index;
+		if (!freeSlots.empty())
+		{
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			index = (u32)slots.size();
+			slots.push_back(ResourceSlot());
+		}
+
+		ResourceSlot& slot = slots[index];
+		slot.key = key;
+		slot.refCount = 1;
+		slot.alive = true;
+		slotIndices[key] = index;
+		return index;
+	}
+
+	ResourceSlot* Get(u32 index, u32 generation)
+	{
+		if (index >= slots.size() || !slots[index].alive || slots[index].generation != generation) return nullptr;
+		return &slots[index];
+	}
+
+	void Free(u32 index)
+	{
+		ResourceSlot& slot = slots[index];
+		slotIndices.erase(slot.key);
+		slot.key.clear();
+		slot.generation++;
+		slot.refCount = 0;
+		slot.alive = false;
+		freeSlots.push_back(index);
+	}
+};
+
+static ResourceSlotTable textureSlots;
+static ResourceSlotTable fontSlots;
+static u64 textureMemoryBudget = 0;
+static u32 resourceFrame = 0;
+
+TextureHandle AcquireTexture(std::string filenameAndPath)
+{
+	if (LoadTexture(filenameAndPath) == nullptr) return TextureHandle();
+
+	u32 index = textureSlots.Acquire(filenameAndPath);
+	textureSlots.slots[index].lastUsedFrame = resourceFrame;
+	return { index, textureSlots.slots[index].generation };
+}
+
+void ReleaseTexture(TextureHandle handle)
+{
+	ResourceSlot* slot = textureSlots.Get(handle.index, handle.generation);
+	if (slot != nullptr && slot->refCount > 0) slot->refCount--;
+}
+
+Texture* GetTexture(TextureHandle handle)
+{
+	ResourceSlot* slot = textureSlots.Get(handle.index, handle.generation);
+	if (slot == nullptr) return nullptr;
+
+	slot->lastUsedFrame = resourceFrame;
+	return &textures[slot->key];
+}
+
+static bool UnloadTextureSlot(u32 index)
+{
+	ResourceSlot& slot = textureSlots.slots[index];
+	auto it = textures.find(slot.key);
+
+	//Async textures can't go until their upload has landed
+	if (it != textures.end())
+	{
+		if (it->second.loading) return false;
+		if (it->second.id != 0) DeleteTexture(it->second.id);
+		textures.erase(it);
+	}
+
+	std::cout << "Texture unloaded : @" << slot.key << "\n";
+	textureSlots.Free(index);
+	return true;
+}
+
+bool UnloadTexture(TextureHandle handle)
+{
+	if (textureSlots.Get(handle.index, handle.generation) == nullptr) return false;
+	return UnloadTextureSlot(handle.index);
+}
+
+static FontHandle AcquireFontKey(Font* font, const std::string& fontKey)
+{
+	if (font == nullptr) return FontHandle();
+
+	u32 index = fontSlots.Acquire(fontKey);
+	fontSlots.slots[index].lastUsedFrame = resourceFrame;
+	return { index, fontSlots.slots[index].generation };
+}
+
+FontHandle AcquireFont(std::string filePath, u32 pixelHeight)
+{
+	return AcquireFontKey(LoadFont(filePath, pixelHeight), filePath + "(" + std::to_string(pixelHeight) + "px)");
+}
+
+FontHandle AcquireFontSDF(std::string filePath)
+{
+	return AcquireFontKey(LoadFontSDF(filePath), filePath + "(sdf)");
+}
+
+void ReleaseFont(FontHandle handle)
+{
+	ResourceSlot* slot = fontSlots.Get(handle.index, handle.generation);
+	if (slot != nullptr && slot->refCount > 0) slot->refCount--;
+}
+
+Font* GetFont(FontHandle handle)
+{
+	ResourceSlot* slot = fontSlots.Get(handle.index, handle.generation);
+	if (slot == nullptr) return nullptr;
+
+	slot->lastUsedFrame = resourceFrame;
+	return &fonts[slot->key];
+}
+
+bool UnloadFont(FontHandle handle)
+{
+	ResourceSlot* slot = fontSlots.Get(handle.index, handle.generation);
+	if (slot == nullptr) return false;
+
+	auto it = fonts.find(slot->key);
+	if (it != fonts.end())
+	{
+		Font& font = it->second;
+
+		//Fonts still loading are a copy of the placeholder and share its source, so neither can go yet
+		if (font.loading || &font == placeholderFont) return false;
+
+		//Fonts whose load failed stay a copy of the placeholder, the source is the placeholder's and isn't freed here
+		bool ownsSource = font.source != nullptr && (placeholderFont == nullptr || font.source != placeholderFont->source);
+
+		//Its glyphs stay in the atlas until the next compaction, which only looks at fonts that are still loaded
+		if (ownsSource)
+		{
+			delete[] font.source->buffer;
+			delete font.source;
+		}
+
+		fonts.erase(it);
+
+		//Cached layouts are keyed on the font pointer, which a later font could reuse
+		glyphAtlasGeneration++;
+	}
+
+	std::cout << "Font unloaded : @" << slot->key << "\n";
+	fontSlots.Free(handle.index);
+	return true;
+}
+
+void SetTextureMemoryBudget(u64 bytes)
+{
+	textureMemoryBudget = bytes;
+}
+
+ResourceMemoryStats GetResourceMemoryStats()
+{
+	ResourceMemoryStats stats = {};
+
+	for (auto& pair : textures)
+	{
+		stats.textureBytes += pair.second.memorySize;
+		stats.textureCount++;
+	}
+
+	for (auto& pair : fonts)
+	{
+		if (!pair.second.loading && pair.second.source != nullptr) stats.fontBytes += pair.second.source->bufferSize;
+		stats.fontCount++;
+	}
+
+	if (glyphAtlasPixels != nullptr) stats.glyphAtlasBytes = (u64)GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE;
+
+	return stats;
+}
+
+void TrimResourceCache()
+{
+#ifdef TRACY_ENABLE
+	ZoneScoped;
+#endif
+
+	resourceFrame++;
+	if (textureMemoryBudget == 0) return;
+
+	u64 textureBytes = 0;
+	for (auto& pair : textures) textureBytes += pair.second.memorySize;
+	if (textureBytes <= textureMemoryBudget) return;
+
+	//Only unreferenced handle textures are candidates, oldest first. Textures from LoadTexture have no slot and stay
+	std::vector<u32> candidates;
+	for (u32 i = 0; i < textureSlots.slots.size(); i++)
+	{
+		const ResourceSlot& slot = textureSlots.slots[i];
+		if (slot.alive && slot.refCount == 0 && slot.lastUsedFrame != resourceFrame - 1) candidates.push_back(i);
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](u32 a, u32 b)
+	{
+		return textureSlots.slots[a].lastUsedFrame < textureSlots.slots[b].lastUsedFrame;
+	});
+
+	for (u32 index : candidates)
+	{
+		if (textureBytes <= textureMemoryBudget) break;
+
+		u64 size = textures[textureSlots.slots[index].key].memorySize;
+		if (UnloadTextureSlot(index)) textureBytes -= size;
+	}
+}
@@ -0,0 +1,384 @@
+//bingus_pack - bakes the res folder into a single resource pack
+//Usage: bingus_pack <res directory> <output pack>
+//       bingus_pack --dds <input image> <output .dds>
+//
+//Textures are decoded, flipped and mipmapped here so the runtime only has to upload them, shaders and fonts are
+//stored as-is. The runtime maps the pack and reads everything in place, see MountResourcePack
+//
+//--dds converts an image to a block compressed .dds with a full mip chain for LoadTexture. Opaque images become
+//BC1 and anything with alpha becomes BC3, rows are flipped to match the engine's other textures
+
+#include "bingus_pack.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct PackItem
+{
+	BingusPackEntry entry;
+	std::vector<uint8_t> data;
+};
+
+static bool ReadFile(const fs::path& path, std::vector<uint8_t>& data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (file.fail()) return false;
+
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+//Box filters each level down from the one above it until 1x1
+static void BuildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, std::vector<uint8_t>& data, uint32_t& mipCount)
+{
+	data.assign(pixels, pixels + (size_t)width * height * 4);
+	mipCount = 1;
+
+	size_t levelOffset = 0;
+	while (width > 1 || height > 1)
+	{
+		uint32_t nextWidth = std::max(width / 2, 1u);
+		uint32_t nextHeight = std::max(height / 2, 1u);
+		size_t nextOffset = data.size();
+		data.resize(nextOffset + (size_t)nextWidth * nextHeight * 4);
+
+		const uint8_t* src = data.data() + levelOffset;
+		uint8_t* dst = data.data() + nextOffset;
+
+		for (uint32_t y = 0; y < nextHeight; y++)
+		{
+			for (uint32_t x = 0; x < nextWidth; x++)
+			{
+				uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					uint32_t sum = src[((size_t)y0 * width + x0) * 4 + c] + src[((size_t)y0 * width + x1) * 4 + c]
+						+ src[((size_t)y1 * width + x0) * 4 + c] + src[((size_t)y1 * width + x1) * 4 + c];
+					dst[((size_t)y * nextWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+				}
+			}
+		}
+
+		levelOffset = nextOffset;
+		width = nextWidth;
+		height = nextHeight;
+		mipCount++;
+	}
+}
+
+//Block compression, endpoints are the bounding box of the block's colours and each texel takes the nearest palette entry
+static uint16_t EncodeColor565(const int rgb[3])
+{
+	return (uint16_t)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255));
+}
+
+static void DecodeColor565(uint16_t color, int rgb[3])
+{
+	rgb[0] = ((color >> 11) & 0x1F) * 255 / 31;
+	rgb[1] = ((color >> 5) & 0x3F) * 255 / 63;
+	rgb[2] = (color & 0x1F) * 255 / 31;
+}
+
+static void EncodeBC1Block(const uint8_t texels[16 * 4], uint8_t* block)
+{
+	int minColor[3] = { 255, 255, 255 }, maxColor[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			minColor[c] = std::min(minColor[c], (int)texels[i * 4 + c]);
+			maxColor[c] = std::max(maxColor[c], (int)texels[i * 4 + c]);
+		}
+	}
+
+	uint16_t color0 = EncodeColor565(maxColor);
+	uint16_t color1 = EncodeColor565(minColor);
+
+	//color0 > color1 selects the four colour mode, equal endpoints just use index 0 everywhere
+	if (color0 < color1) std::swap(color0, color1);
+
+	int palette[4][3];
+	DecodeColor565(color0, palette[0]);
+	DecodeColor565(color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int diff = (int)texels[i * 4 + c] - palette[p][c];
+					error += diff * diff;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+
+			indices |= (uint32_t)best << (i * 2);
+		}
+	}
+
+	block[0] = (uint8_t)(color0 & 0xFF);
+	block[1] = (uint8_t)(color0 >> 8);
+	block[2] = (uint8_t)(color1 & 0xFF);
+	block[3] = (uint8_t)(color1 >> 8);
+	for (int i = 0; i < 4; i++) block[4 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+static void EncodeBC3AlphaBlock(const uint8_t texels[16 * 4], uint8_t* block)
+{
+	int minAlpha = 255, maxAlpha = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		minAlpha = std::min(minAlpha, (int)texels[i * 4 + 3]);
+		maxAlpha = std::max(maxAlpha, (int)texels[i * 4 + 3]);
+	}
+
+	//alpha0 > alpha1 selects the eight alpha mode
+	int alphas[8] = { maxAlpha, minAlpha };
+	for (int i = 1; i < 7; i++) alphas[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+
+	uint64_t indices = 0;
+	if (maxAlpha != minAlpha)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 8; p++)
+			{
+				int error = std::abs((int)texels[i * 4 + 3] - alphas[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = p;
+				}
+			}
+
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	block[0] = (uint8_t)maxAlpha;
+	block[1] = (uint8_t)minAlpha;
+	for (int i = 0; i < 6; i++) block[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+static void CompressLevel(const uint8_t* pixels, uint32_t width, uint32_t height, bool alpha, std::vector<uint8_t>& out)
+{
+	for (uint32_t by = 0; by < (height + 3) / 4; by++)
+	{
+		for (uint32_t bx = 0; bx < (width + 3) / 4; bx++)
+		{
+			//Edge blocks repeat the last row/column
+			uint8_t texels[16 * 4];
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				for (uint32_t x = 0; x < 4; x++)
+				{
+					uint32_t sx = std::min(bx * 4 + x, width - 1);
+					uint32_t sy = std::min(by * 4 + y, height - 1);
+					memcpy(texels + (y * 4 + x) * 4, pixels + ((size_t)sy * width + sx) * 4, 4);
+				}
+			}
+
+			size_t offset = out.size();
+			out.resize(offset + (alpha ? 16 : 8));
+			if (alpha)
+			{
+				EncodeBC3AlphaBlock(texels, out.data() + offset);
+				EncodeBC1Block(texels, out.data() + offset + 8);
+			}
+			else
+			{
+				EncodeBC1Block(texels, out.data() + offset);
+			}
+		}
+	}
+}
+
+static int ConvertToDDS(const char* inputPath, const char* outputPath)
+{
+	int width, height, channels;
+	stbi_set_flip_vertically_on_load(true);
+	uint8_t* pixels = stbi_load(inputPath, &width, &height, &channels, 4);
+	if (pixels == nullptr)
+	{
+		std::cout << "Failed to read " << inputPath << "\n";
+		return 1;
+	}
+
+	bool alpha = false;
+	for (size_t i = 0; i < (size_t)width * height; i++) alpha |= pixels[i * 4 + 3] != 255;
+
+	std::vector<uint8_t> mips;
+	uint32_t mipCount;
+	BuildMipChain(pixels, (uint32_t)width, (uint32_t)height, mips, mipCount);
+	stbi_image_free(pixels);
+
+	std::vector<uint8_t> blocks;
+	size_t levelOffset = 0;
+	uint32_t levelWidth = (uint32_t)width, levelHeight = (uint32_t)height;
+	for (uint32_t level = 0; level < mipCount; level++)
+	{
+		CompressLevel(mips.data() + levelOffset, levelWidth, levelHeight, alpha, blocks);
+		levelOffset += (size_t)levelWidth * levelHeight * 4;
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+	}
+
+	//Magic followed by the 124 byte DDS_HEADER, see the DirectX docs for the field layout
+	uint32_t header[32] = {};
+	header[0] = 0x20534444; //"DDS "
+	header[1] = 124;
+	header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; //Caps, height, width, pixel format, mip count, linear size
+	header[3] = (uint32_t)height;
+	header[4] = (uint32_t)width;
+	header[5] = ((width + 3) / 4) * ((height + 3) / 4) * (alpha ? 16 : 8);
+	header[7] = mipCount;
+	header[19] = 32; //Pixel format size
+	header[20] = 0x4; //Four CC
+	header[21] = alpha ? 0x35545844 : 0x31545844; //"DXT5" or "DXT1"
+	header[27] = 0x1000 | 0x400000 | 0x8; //Texture, mipmap, complex
+
+	std::ofstream out(outputPath, std::ios::binary);
+	if (out.fail())
+	{
+		std::cout << "Failed to open " << outputPath << " for writing\n";
+		return 1;
+	}
+
+	out.write((const char*)header, sizeof(header));
+	out.write((const char*)blocks.data(), (std::streamsize)blocks.size());
+
+	std::cout << "Wrote " << outputPath << " (" << (alpha ? "BC3" : "BC1") << ", " << mipCount << " mips, " << blocks.size() << " bytes)\n";
+	return 0;
+}
+
+static bool AddDirectory(const fs::path& directory, BingusPackEntryType type, std::vector<PackItem>& items)
+{
+	if (!fs::exists(directory)) return true;
+
+	for (const fs::directory_entry& file : fs::recursive_directory_iterator(directory))
+	{
+		if (!file.is_regular_file()) continue;
+
+		std::string name = fs::relative(file.path(), directory).generic_string();
+		if (name.size() >= BINGUS_PACK_NAME_LENGTH)
+		{
+			std::cout << "Skipping " << name << ", name is too long\n";
+			continue;
+		}
+
+		PackItem item = {};
+		strncpy(item.entry.name, name.c_str(), BINGUS_PACK_NAME_LENGTH - 1);
+		item.entry.type = type;
+
+		if (type == BINGUS_PACK_TEXTURE)
+		{
+			int width, height, channels;
+			stbi_set_flip_vertically_on_load(true);
+			uint8_t* pixels = stbi_load(file.path().string().c_str(), &width, &height, &channels, 4);
+			if (pixels == nullptr)
+			{
+				std::cout << "Skipping " << name << ", not an image stb_image can read\n";
+				continue;
+			}
+
+			item.entry.width = (uint32_t)width;
+			item.entry.height = (uint32_t)height;
+			BuildMipChain(pixels, item.entry.width, item.entry.height, item.data, item.entry.mipCount);
+			stbi_image_free(pixels);
+		}
+		else if (!ReadFile(file.path(), item.data))
+		{
+			std::cout << "Failed to read " << file.path() << "\n";
+			return false;
+		}
+
+		std::cout << "Packed " << name << " (" << item.data.size() << " bytes)\n";
+		items.push_back(std::move(item));
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 4 && strcmp(argv[1], "--dds") == 0) return ConvertToDDS(argv[2], argv[3]);
+
+	if (argc != 3)
+	{
+		std::cout << "Usage: bingus_pack <res directory> <output pack>\n";
+		std::cout << "       bingus_pack --dds <input image> <output .dds>\n";
+		return 1;
+	}
+
+	fs::path resPath = argv[1];
+	std::vector<PackItem> items;
+
+	if (!AddDirectory(resPath / "textures", BINGUS_PACK_TEXTURE, items)
+		|| !AddDirectory(resPath / "shaders", BINGUS_PACK_SHADER, items)
+		|| !AddDirectory(resPath / "fonts", BINGUS_PACK_FONT, items))
+	{
+		return 1;
+	}
+
+	//Lay out the data after the entry table
+	BingusPackHeader header = { BINGUS_PACK_MAGIC, BINGUS_PACK_VERSION, (uint32_t)items.size(), 0 };
+	uint64_t offset = sizeof(BingusPackHeader) + sizeof(BingusPackEntry) * items.size();
+
+	for (PackItem& item : items)
+	{
+		offset = (offset + BINGUS_PACK_ALIGNMENT - 1) & ~(uint64_t)(BINGUS_PACK_ALIGNMENT - 1);
+		item.entry.offset = offset;
+		item.entry.size = item.data.size();
+		offset += item.data.size();
+	}
+
+	std::ofstream out(argv[2], std::ios::binary);
+	if (out.fail())
+	{
+		std::cout << "Failed to open " << argv[2] << " for writing\n";
+		return 1;
+	}
+
+	out.write((const char*)&header, sizeof(header));
+	for (const PackItem& item : items) out.write((const char*)&item.entry, sizeof(BingusPackEntry));
+
+	for (const PackItem& item : items)
+	{
+		static const char padding[BINGUS_PACK_ALIGNMENT] = {};
+		uint64_t position = (uint64_t)out.tellp();
+		out.write(padding, (std::streamsize)(item.entry.offset - position));
+		out.write((const char*)item.data.data(), (std::streamsize)item.data.size());
+	}
+
+	std::cout << "Wrote " << items.size() << " resources to " << argv[2] << " (" << offset << " bytes)\n";
+	return 0;
+}